@@ -0,0 +1,49 @@
+/** @file */
+#ifndef __BENCH_H
+#define __BENCH_H
+
+#include <chrono>
+
+/**
+ * Helpers shared by the benchmarks in this directory. Every benchmark is one file with its
+ * own main(), and the command that builds and runs it is at its top. The headers in src/
+ * include ElementNotExist.h, which has to be on the include path as for any other user.
+ */
+
+/**
+ * Returns the fastest of reps runs of f(), in seconds.
+ */
+template <class F>
+double bestOf(int reps, F f) {
+    double best = 0;
+    for (int i = 0; i < reps; i ++){
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        f();
+        double t = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        if (i == 0 || t < best) best = t;
+    }
+    return best;
+}
+
+/**
+ * Keeps the compiler from dropping the computation of x when it is not used otherwise.
+ */
+template <class T>
+inline void keep(const T &x) {asm volatile("" : : "r"(&x) : "memory");}
+
+/**
+ * A splitmix64 stream of pseudo-random numbers, the same on every platform.
+ */
+struct BenchRandom
+{
+    unsigned long long s;
+    explicit BenchRandom(unsigned long long seed = 1): s(seed) {}
+    unsigned long long next() {
+        unsigned long long x = (s += 0x9e3779b97f4a7c15ULL);
+        x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ULL;
+        x ^= x >> 27; x *= 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+};
+
+#endif
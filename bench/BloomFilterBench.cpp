@@ -0,0 +1,52 @@
+/*
+ * containsKey() on HashMap and TreeMap with and without a bloom filter, for keys that are
+ * missing and keys that are present, over 1M random keys.
+ *
+ *      g++ -std=c++11 -O2 -Isrc bench/BloomFilterBench.cpp -o bloom_bench && ./bloom_bench
+ */
+//TreeMap.h calls rand() and time() without including their headers
+#include <cstdlib>
+#include <ctime>
+#include "Bench.h"
+#include "HashFunctions.h"
+#include "HashMap.h"
+#include "TreeMap.h"
+#include <cstdio>
+#include <vector>
+
+static const int Keys = 1 << 20;
+
+//nanoseconds per containsKey() of every key in keys
+template <class M>
+double lookup(const M &m, const std::vector<long long> &keys) {
+    int found = 0;
+    double t = bestOf(3, [&](){
+        for (size_t i = 0; i < keys.size(); i ++) found += m.containsKey(keys[i]);
+    });
+    keep(found);
+    return t * 1e9 / keys.size();
+}
+
+int main() {
+    //present keys are even and missing ones odd, both in random order
+    std::vector<long long> present(Keys), missing(Keys);
+    BenchRandom r;
+    for (int i = 0; i < Keys; i ++){
+        present[i] = (long long)(r.next() >> 2) * 2;
+        missing[i] = (long long)(r.next() >> 2) * 2 + 1;
+    }
+    printf("ns per containsKey, %d keys\n%-24s %10s %10s\n", Keys, "map", "miss", "hit");
+
+    HashMap<long long, int, IntHash> h(Keys);
+    for (int i = 0; i < Keys; i ++) h.put(present[i], i);
+    printf("%-24s %10.1f %10.1f\n", "HashMap", lookup(h, missing), lookup(h, present));
+    h.setBloomFilter(Keys);
+    printf("%-24s %10.1f %10.1f\n", "HashMap + bloom filter", lookup(h, missing), lookup(h, present));
+
+    TreeMap<long long, int> t;
+    for (int i = 0; i < Keys; i ++) t.put(present[i], i);
+    printf("%-24s %10.1f %10.1f\n", "TreeMap", lookup(t, missing), lookup(t, present));
+    t.setBloomFilter<IntHash>(Keys);
+    printf("%-24s %10.1f %10.1f\n", "TreeMap + bloom filter", lookup(t, missing), lookup(t, present));
+    return 0;
+}
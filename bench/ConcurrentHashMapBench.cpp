@@ -0,0 +1,75 @@
+/*
+ * Throughput of ConcurrentHashMap against a HashMap behind one mutex, with 1, 2, 4 and 8
+ * threads, on a read-heavy (90% get) and a write-heavy (50% get) mix over 1M keys.
+ *
+ *      g++ -std=c++11 -O2 -pthread -Isrc bench/ConcurrentHashMapBench.cpp -o chm_bench
+ *      ./chm_bench
+ */
+#include "Bench.h"
+#include "ConcurrentHashMap.h"
+#include "HashFunctions.h"
+#include "HashMap.h"
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+static const int Keys = 1 << 20;
+static const int Ops = 1 << 22;
+
+//a HashMap that every call locks as a whole
+struct LockedHashMap
+{
+    std::mutex lock;
+    HashMap<long long, long long, IntHash> map;
+
+    bool find(long long key, long long &out) {
+        std::lock_guard<std::mutex> g(lock);
+        const long long *v = map.find(key);
+        if (v != NULL) out = *v;
+        return v != NULL;
+    }
+    void put(long long key, long long value) {
+        std::lock_guard<std::mutex> g(lock);
+        map.put(key, value);
+    }
+};
+
+//Ops operations split over threads, reads in a hundred of them gets, on keys [0, 2 * Keys)
+//of which half are present. Returns millions of operations per second
+template <class M>
+double run(M &m, int threads, int reads) {
+    double t = bestOf(3, [&](){
+        std::vector<std::thread> pool;
+        for (int id = 0; id < threads; id ++)
+            pool.push_back(std::thread([&m, id, threads, reads](){
+                BenchRandom r(id + 1);
+                long long found = 0, v;
+                for (int i = 0; i < Ops / threads; i ++){
+                    unsigned long long x = r.next();
+                    long long key = (long long)(x % (2 * Keys));
+                    if ((int)(x >> 40) % 100 < reads) found += m.find(key, v);
+                        else m.put(key, key);
+                }
+                keep(found);
+            }));
+        for (size_t i = 0; i < pool.size(); i ++) pool[i].join();
+    });
+    return Ops / t / 1e6;
+}
+
+int main() {
+    printf("hardware threads: %u\n", std::thread::hardware_concurrency());
+    printf("%5s %8s %18s %18s\n", "gets", "threads", "Concurrent Mops/s", "Locked Mops/s");
+    const int mixes[] = {90, 50};
+    const int threads[] = {1, 2, 4, 8};
+    for (int i = 0; i < 2; i ++)
+        for (int j = 0; j < 4; j ++){
+            ConcurrentHashMap<long long, long long, IntHash> c;
+            LockedHashMap l;
+            for (long long k = 0; k < Keys; k ++) {c.put(2 * k, k); l.put(2 * k, k);}
+            double a = run(c, threads[j], mixes[i]), b = run(l, threads[j], mixes[i]);
+            printf("%4d%% %8d %18.1f %18.1f\n", mixes[i], threads[j], a, b);
+        }
+    return 0;
+}
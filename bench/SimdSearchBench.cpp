@@ -0,0 +1,57 @@
+/*
+ * ArrayList::contains and count on int and double against the plain operator== loop they
+ * used before, over 1M elements with the searched value absent, so every element is read.
+ *
+ *      g++ -std=c++11 -O2 -mavx2 -Isrc bench/SimdSearchBench.cpp -o simd_bench && ./simd_bench
+ *      g++ -std=c++11 -O2 -Isrc bench/SimdSearchBench.cpp -o simd_bench && ./simd_bench
+ *
+ * The first builds the AVX2 kernels, the second the SSE2 ones of a plain x86-64 target.
+ */
+#include "ArrayList.h"
+#include "Bench.h"
+#include "SimdSearch.h"
+#include <cstdio>
+
+static const int N = 1 << 20;
+static const int Reps = 200;
+
+template <class T>
+void run(const char *name) {
+    ArrayList<T> a;
+    BenchRandom r;
+    for (int i = 0; i < N; i ++) a.add((T)(r.next() % 1000000));
+    //the length is only known at run time, as it is inside ArrayList
+    const T *p = &a.get(0);
+    const int n = a.size();
+    const T missing = (T)-1;
+    int hits = 0;
+    double loop = bestOf(3, [&](){
+        for (int i = 0; i < Reps; i ++) {hits += SimdSearchImpl<T, void>::indexOf(p, n, missing) != -1; keep(hits);}
+    });
+    double simd = bestOf(3, [&](){
+        for (int i = 0; i < Reps; i ++) {hits += a.contains(missing); keep(hits);}
+    });
+    double loopCount = bestOf(3, [&](){
+        for (int i = 0; i < Reps; i ++) {hits += SimdSearchImpl<T, void>::count(p, n, (T)7); keep(hits);}
+    });
+    double simdCount = bestOf(3, [&](){
+        for (int i = 0; i < Reps; i ++) {hits += a.count((T)7); keep(hits);}
+    });
+    keep(hits);
+    printf("%-8s %-9s %10.3f %10.3f %8.1fx\n", name, "contains", loop * 1e3 / Reps, simd * 1e3 / Reps, loop / simd);
+    printf("%-8s %-9s %10.3f %10.3f %8.1fx\n", name, "count", loopCount * 1e3 / Reps, simdCount * 1e3 / Reps, loopCount / simdCount);
+}
+
+int main() {
+#if defined(__SIMDSEARCH_AVX2)
+    printf("kernels: AVX2\n");
+#elif defined(__SIMDSEARCH_SSE2)
+    printf("kernels: SSE2\n");
+#else
+    printf("kernels: none\n");
+#endif
+    printf("%-8s %-9s %10s %10s %9s\n", "type", "call", "loop ms", "simd ms", "speedup");
+    run<int>("int");
+    run<double>("double");
+    return 0;
+}
@@ -0,0 +1,72 @@
+/*
+ * HashMap under a hash function that maps every key to the same code: the treeified bucket
+ * against the plain chain it replaced. Keys without operator< are never treeified, so the
+ * same keys wrapped in a type without it give the chain. Times are per put while loading
+ * n keys, and per get of a present key.
+ *
+ *      g++ -std=c++11 -O2 -Isrc bench/TreeifyBench.cpp -o treeify_bench && ./treeify_bench
+ */
+#include "Bench.h"
+#include "HashFunctions.h"
+#include "HashMap.h"
+#include <cstdio>
+#include <vector>
+
+struct Ordered
+{
+    long long v;
+    bool operator==(const Ordered &x) const {return v == x.v;}
+    bool operator<(const Ordered &x) const {return v < x.v;}
+};
+
+struct Unordered
+{
+    long long v;
+    bool operator==(const Unordered &x) const {return v == x.v;}
+};
+
+struct Colliding
+{
+    template <class T>
+    static int hashCode(const T &) {return 42;}
+};
+
+struct Spread
+{
+    template <class T>
+    static int hashCode(const T &key) {return IntHash::hashCode(key.v);}
+};
+
+//nanoseconds per put and per get of n keys
+template <class K, class H>
+void run(int n, double &put, double &get) {
+    std::vector<K> keys(n);
+    BenchRandom r;
+    for (int i = 0; i < n; i ++) keys[i].v = (long long)r.next();
+    long long sum = 0;
+    put = bestOf(3, [&](){
+        HashMap<K, int, H> m;
+        for (int i = 0; i < n; i ++) m.put(keys[i], i);
+        sum += m.size();
+    }) * 1e9 / n;
+    HashMap<K, int, H> m;
+    for (int i = 0; i < n; i ++) m.put(keys[i], i);
+    get = bestOf(3, [&](){
+        for (int i = 0; i < n; i ++) sum += m.get(keys[i]);
+    }) * 1e9 / n;
+    keep(sum);
+}
+
+int main() {
+    printf("ns per operation, all keys with one hash code except in the last columns\n");
+    printf("%7s %12s %12s %12s %12s %12s %12s\n", "keys", "tree put", "tree get", "chain put", "chain get", "spread put", "spread get");
+    const int sizes[] = {64, 1024, 4096, 16384};
+    for (int i = 0; i < 4; i ++){
+        double tp, tg, cp, cg, sp, sg;
+        run<Ordered, Colliding>(sizes[i], tp, tg);
+        run<Unordered, Colliding>(sizes[i], cp, cg);
+        run<Ordered, Spread>(sizes[i], sp, sg);
+        printf("%7d %12.1f %12.1f %12.1f %12.1f %12.1f %12.1f\n", sizes[i], tp, tg, cp, cg, sp, sg);
+    }
+    return 0;
+}
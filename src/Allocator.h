@@ -0,0 +1,273 @@
+/** @file */
+#ifndef __ALLOCATOR_H
+#define __ALLOCATOR_H
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+/**
+ * Allocators for the A template parameter of the containers.
+ *
+ * An allocator is a small copyable handle with
+ * @code
+ *      void *allocate(size_t bytes);
+ *      void deallocate(void *p, size_t bytes);
+ *      void *reallocate(void *p, size_t oldBytes, size_t newBytes);
+ *      static const bool noopDeallocate;
+ *      bool operator==(const A &) const;
+ * @endcode
+ * allocate() returns memory aligned for any fundamental type and throws std::bad_alloc
+ * on failure. reallocate() may move the block bytewise, so containers only use it for
+ * trivially copyable contents. Two handles compare equal if memory allocated through one
+ * can be freed through the other. When noopDeallocate is true, deallocate() does nothing
+ * and containers skip freeing their nodes one by one on destruction.
+ *
+ * Copies of a container share the allocator of the original.
+ */
+
+/**
+ * The default allocator, malloc and free.
+ */
+struct HeapAllocator
+{
+    static const bool noopDeallocate = false;
+
+    void *allocate(size_t n) {
+        void *p = std::malloc(n ? n : 1);
+        if (p == NULL) throw std::bad_alloc();
+        return p;
+    }
+    void deallocate(void *p, size_t) {std::free(p);}
+    void *reallocate(void *p, size_t, size_t n) {
+        void *q = std::realloc(p, n ? n : 1);
+        if (q == NULL) throw std::bad_alloc();
+        return q;
+    }
+    bool operator==(const HeapAllocator &) const {return true;}
+    bool operator!=(const HeapAllocator &) const {return false;}
+};
+
+/**
+ * A bump-pointer arena. Allocation carves the next bytes out of the current block, freeing a
+ * single allocation does nothing, and reset() gives back everything at once.
+ *
+ * Containers using an arena must be destroyed, or never touched again, before the arena is
+ * reset. Not thread-safe.
+ */
+class Arena
+{
+    struct Block{
+        Block *next;
+        size_t size;
+    };
+    static const size_t Align = alignof(std::max_align_t);
+    static const size_t HeadSize = (sizeof(Block) + Align - 1) / Align * Align;
+
+    Block *head;
+    char *cur, *end, *last;
+    size_t blockSize, used;
+
+    void grow(size_t n) {
+        size_t sz = n + HeadSize > blockSize ? n + HeadSize : blockSize;
+        Block *b = static_cast<Block *>(std::malloc(sz));
+        if (b == NULL) throw std::bad_alloc();
+        b->next = head; b->size = sz; head = b;
+        cur = reinterpret_cast<char *>(b) + HeadSize;
+        end = reinterpret_cast<char *>(b) + sz;
+    }
+
+    Arena(const Arena &);
+    Arena &operator=(const Arena &);
+public:
+    /**
+     * Constructs an empty arena that takes memory from malloc blockSize bytes at a time.
+     */
+    explicit Arena(size_t _blockSize = 1 << 16): head(NULL), cur(NULL), end(NULL), last(NULL), blockSize(_blockSize), used(0) {}
+
+    ~Arena() {release();}
+
+    void *allocate(size_t n) {
+        n = (n + Align - 1) / Align * Align;
+        if (n == 0) n = Align;
+        if ((size_t)(end - cur) < n) grow(n);
+        last = cur; cur += n; used += n;
+        return last;
+    }
+
+    /**
+     * Resizes the block p, in place if it is the latest allocation and the block has room.
+     */
+    void *reallocate(void *p, size_t oldN, size_t n) {
+        size_t a = (n + Align - 1) / Align * Align;
+        if (p != NULL && p == last && (size_t)(end - last) >= a) {
+            used += a - (cur - last);
+            cur = last + a;
+            return p;
+        }
+        void *q = allocate(n);
+        if (p != NULL) std::memcpy(q, p, oldN < n ? oldN : n);
+        return q;
+    }
+
+    /**
+     * Gives back everything allocated so far. The newest block is kept for reuse.
+     */
+    void reset() {
+        if (head == NULL) return;
+        Block *keep = head;
+        head = head->next;
+        release();
+        head = keep; head->next = NULL;
+        cur = reinterpret_cast<char *>(head) + HeadSize;
+        end = reinterpret_cast<char *>(head) + head->size;
+    }
+
+    /**
+     * Returns every block to malloc.
+     */
+    void release() {
+        while (head != NULL) {Block *b = head; head = head->next; std::free(b);}
+        cur = end = last = NULL; used = 0;
+    }
+
+    /**
+     * Returns the number of bytes handed out since the last reset.
+     */
+    size_t bytesUsed() const {return used;}
+};
+
+/**
+ * Allocator handle drawing from an Arena.
+ */
+class ArenaAllocator
+{
+    Arena *arena;
+public:
+    static const bool noopDeallocate = true;
+
+    ArenaAllocator(Arena &a): arena(&a) {}
+
+    void *allocate(size_t n) {return arena->allocate(n);}
+    void deallocate(void *, size_t) {}
+    void *reallocate(void *p, size_t oldN, size_t n) {return arena->reallocate(p, oldN, n);}
+    bool operator==(const ArenaAllocator &x) const {return arena == x.arena;}
+    bool operator!=(const ArenaAllocator &x) const {return arena != x.arena;}
+};
+
+/**
+ * A pool of fixed-size nodes. Requests are rounded up to a multiple of Granule bytes and
+ * every size keeps its own free list, carved out of large chunks, so freeing and reusing a
+ * node is a pointer swap. Requests above MaxNode bytes, such as the arrays of the list
+ * containers, go to malloc. release() gives all chunks back at once.
+ *
+ * Not thread-safe.
+ */
+class NodePool
+{
+    static const size_t Granule = alignof(std::max_align_t);
+    static const size_t MaxNode = 512;
+    static const size_t Classes = MaxNode / Granule;
+
+    struct FreeNode{
+        FreeNode *next;
+    };
+    struct Chunk{
+        Chunk *next;
+    };
+    static const size_t HeadSize = (sizeof(Chunk) + Granule - 1) / Granule * Granule;
+
+    FreeNode *freeList[Classes];
+    Chunk *chunks;
+    size_t chunkSize;
+
+    //fills the free list of class c from a fresh chunk
+    void refill(size_t c) {
+        size_t sz = (c + 1) * Granule;
+        size_t n = (chunkSize - HeadSize) / sz;
+        if (n == 0) n = 1;
+        Chunk *ch = static_cast<Chunk *>(std::malloc(HeadSize + n * sz));
+        if (ch == NULL) throw std::bad_alloc();
+        ch->next = chunks; chunks = ch;
+        char *p = reinterpret_cast<char *>(ch) + HeadSize;
+        for (size_t i = 0; i < n; i ++, p += sz) {
+            FreeNode *f = reinterpret_cast<FreeNode *>(p);
+            f->next = freeList[c]; freeList[c] = f;
+        }
+    }
+
+    NodePool(const NodePool &);
+    NodePool &operator=(const NodePool &);
+public:
+    /**
+     * Constructs an empty pool that takes memory from malloc chunkSize bytes at a time.
+     */
+    explicit NodePool(size_t _chunkSize = 1 << 16): chunks(NULL), chunkSize(_chunkSize) {
+        for (size_t i = 0; i < Classes; i ++) freeList[i] = NULL;
+    }
+
+    ~NodePool() {release();}
+
+    void *allocate(size_t n) {
+        if (n > MaxNode) {
+            void *p = std::malloc(n);
+            if (p == NULL) throw std::bad_alloc();
+            return p;
+        }
+        size_t c = n ? (n - 1) / Granule : 0;
+        if (freeList[c] == NULL) refill(c);
+        FreeNode *f = freeList[c];
+        freeList[c] = f->next;
+        return f;
+    }
+
+    void deallocate(void *p, size_t n) {
+        if (p == NULL) return;
+        if (n > MaxNode) {std::free(p); return;}
+        size_t c = n ? (n - 1) / Granule : 0;
+        FreeNode *f = static_cast<FreeNode *>(p);
+        f->next = freeList[c]; freeList[c] = f;
+    }
+
+    void *reallocate(void *p, size_t oldN, size_t n) {
+        if (oldN > MaxNode && n > MaxNode) {
+            void *q = std::realloc(p, n);
+            if (q == NULL) throw std::bad_alloc();
+            return q;
+        }
+        void *q = allocate(n);
+        if (p != NULL) std::memcpy(q, p, oldN < n ? oldN : n);
+        deallocate(p, oldN);
+        return q;
+    }
+
+    /**
+     * Returns every chunk to malloc. Blocks above MaxNode bytes are not tracked and must
+     * have been deallocated already.
+     */
+    void release() {
+        while (chunks != NULL) {Chunk *c = chunks; chunks = chunks->next; std::free(c);}
+        for (size_t i = 0; i < Classes; i ++) freeList[i] = NULL;
+    }
+};
+
+/**
+ * Allocator handle drawing from a NodePool.
+ */
+class PoolAllocator
+{
+    NodePool *pool;
+public:
+    static const bool noopDeallocate = false;
+
+    PoolAllocator(NodePool &p): pool(&p) {}
+
+    void *allocate(size_t n) {return pool->allocate(n);}
+    void deallocate(void *p, size_t n) {pool->deallocate(p, n);}
+    void *reallocate(void *p, size_t oldN, size_t n) {return pool->reallocate(p, oldN, n);}
+    bool operator==(const PoolAllocator &x) const {return pool == x.pool;}
+    bool operator!=(const PoolAllocator &x) const {return pool != x.pool;}
+};
+
+#endif
@@ -4,39 +4,150 @@
 
 #include "IndexOutOfBound.h"
 #include "ElementNotExist.h"
+#include "Allocator.h"
+#include "ArraySpan.h"
+#include "ParallelAlgorithm.h"
+#include "SimdSearch.h"
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <new>
+#include <type_traits>
+#include <utility>
 
 /**
  * The ArrayList is just like vector in C++.
  * You should know that "capacity" here doesn't mean how many elements are now in this list, where it means
  * the length of the array of your internal implemention
  *
+ * Storage is raw memory: only the slots [0, size) hold constructed elements, so T need not be
+ * default-constructible. Trivially copyable T is grown with realloc and copied with memcpy.
+ * A list may also start on an inline buffer owned by a subclass (see SmallArrayList), which
+ * it uses whenever the elements fit and never frees.
+ *
+ * Memory comes from the allocator A, see Allocator.h.
+ *
  * The iterator iterates in the order of the elements being loaded into this list
  */
-template <class T>
+template <class T, class A = HeapAllocator>
 class ArrayList
 {
-    T *elem;
-    int rear, Size;
+    typedef typename std::is_trivially_copyable<T>::type Trivial;
+
+    T *elem, *local;
+    int rear, Size, localSize;
+    A alloc;
+
+    T *allocate(int n) {return n == 0 ? NULL : static_cast<T *>(alloc.allocate(sizeof(T) * n));}
+    void release(T *p, int n) {if (p != local && p != NULL) alloc.deallocate(p, sizeof(T) * n);}
+
+    static void destroy(T *, int, std::true_type) {}
+    static void destroy(T *p, int n, std::false_type) {for (int i = 0; i < n; i ++) p[i].~T();}
+    static void destroy(T *p, int n) {destroy(p, n, Trivial());}
+
+    //copy-constructs n elements of src into the uninitialized dst
+    static void copyTo(T *dst, const T *src, int n, std::true_type) {if (n) std::memcpy(dst, src, sizeof(T) * n);}
+    static void copyTo(T *dst, const T *src, int n, std::false_type) {
+        for (int i = 0; i < n; i ++) new (dst + i) T(src[i]);
+    }
+
+    //moves n elements of src into the uninitialized dst and destroys the sources
+    static void relocate(T *dst, T *src, int n, std::true_type) {if (n) std::memcpy(dst, src, sizeof(T) * n);}
+    static void relocate(T *dst, T *src, int n, std::false_type) {
+        for (int i = 0; i < n; i ++) {new (dst + i) T(std::move(src[i])); src[i].~T();}
+    }
+
+    void reallocate(int newSize, std::true_type) {
+        elem = static_cast<T *>(alloc.reallocate(elem, sizeof(T) * Size, sizeof(T) * newSize));
+        Size = newSize;
+    }
+    void reallocate(int newSize, std::false_type) {
+        T *p = allocate(newSize);
+        relocate(p, elem, rear, std::false_type());
+        release(elem, Size);
+        elem = p; Size = newSize;
+    }
+    void reallocate(int newSize) {
+        if (newSize <= localSize) {
+            if (elem != local) {relocate(local, elem, rear, Trivial()); release(elem, Size); elem = local;}
+            Size = localSize;
+        } else if (elem == local) {
+            T *p = allocate(newSize);
+            relocate(p, elem, rear, Trivial());
+            elem = p; Size = newSize;
+        } else reallocate(newSize, Trivial());
+    }
+
+    //takes over the elements of x, whose storage is stolen unless it is inline or belongs to
+    //another allocator
+    void steal(ArrayList& x) {
+        if (x.elem == x.local || alloc != x.alloc) {
+            reserve(x.rear);
+            relocate(elem, x.elem, x.rear, Trivial());
+        } else {
+            release(elem, Size);
+            elem = x.elem; Size = x.Size;
+            x.elem = x.local; x.Size = x.localSize;
+        }
+        rear = x.rear; x.rear = 0;
+    }
+
+    void doubleSpace() {reallocate(Size ? 2 * Size : 1);}
 
-    void doubleSpace() {
-        T *tmp = elem;
-        elem = new T[2 * Size];
-        for (int i = 0; i < Size; i ++) elem[i] = tmp[i];
-        Size *= 2; delete [] tmp;
+    //grows at least geometrically so that need elements fit
+    void ensure(int need) {
+        if (need <= Size) return;
+        reallocate(need > 2 * Size ? need : 2 * Size);
     }
+
+    //moves the tail [index, rear) up by n, leaving [index, index + n) uninitialized
+    void openGap(int index, int n, std::true_type) {
+        std::memmove(elem + index + n, elem + index, sizeof(T) * (rear - index));
+    }
+    void openGap(int index, int n, std::false_type) {
+        for (int i = rear - 1; i >= index; i --) {new (elem + i + n) T(std::move(elem[i])); elem[i].~T();}
+    }
+    void openGap(int index, int n) {
+        ensure(rear + n);
+        openGap(index, n, Trivial());
+        rear += n;
+    }
+
+    //destroys [index, index + n) and moves the tail down over it
+    void closeGap(int index, int n, std::true_type) {
+        std::memmove(elem + index, elem + index + n, sizeof(T) * (rear - index - n));
+    }
+    void closeGap(int index, int n, std::false_type) {
+        for (int i = index; i + n < rear; i ++) elem[i] = std::move(elem[i + n]);
+        destroy(elem + rear - n, n);
+    }
+    void closeGap(int index, int n) {
+        closeGap(index, n, Trivial());
+        rear -= n;
+    }
+
+    void sort(std::true_type) {ParallelAlgorithm::radixSort(elem, rear);}
+    void sort(std::false_type) {sort(std::less<T>());}
+protected:
+    /**
+     * Constructs an empty list on the inline buffer buf of n elements. The buffer is used
+     * for as long as the elements fit, and it is never freed.
+     */
+    ArrayList(T *buf, int n, const A &a): alloc(a) {elem = local = buf; Size = localSize = n; rear = 0;}
+
 public:
     class Iterator
     {
-        int pos, rear, Size, last;
+        int pos, last;
         ArrayList *arr;
     public:
-        void init(int _p, ArrayList<T> *_a, int _r, int _S, int L){
-            pos = _p; rear = _r; Size = _S; last = L; arr = _a;
+        void init(ArrayList *_a){
+            pos = 0; last = -1; arr = _a;
         }
         /**
          * TODO Returns true if the iteration has more elements.
          */
-        bool hasNext() {if (pos >= rear) return false; else return true;}
+        bool hasNext() {return pos < arr->rear;}
 
         /**
          * TODO Returns the next element in the iteration.
@@ -44,7 +155,7 @@ public:
          */
         const T &next() {
             if (!hasNext()) throw ElementNotExist("\nNo Such Element\n");
-            last = pos; pos ++; return arr->get(last);
+            last = pos; pos ++; return arr->elem[last];
         }
 
         /**
@@ -53,49 +164,116 @@ public:
          * @throw ElementNotExist
          */
         void remove() {
-            if (last < 0 || last >= rear) throw ElementNotExist("\nNo Such Element\n");
+            if (last < 0) throw ElementNotExist("\nNo Such Element\n");
             arr->removeIndex(last);
-            pos --; rear --; last = -1;
+            pos --; last = -1;
         }
     };
 
     /**
      * TODO Constructs an empty array list.
      */
-    ArrayList() {Size = 1; elem = new T[Size]; rear = 0;}
+    ArrayList() {Size = localSize = 0; elem = local = NULL; rear = 0;}
+
+    /**
+     * Constructs an empty array list drawing memory from the allocator a.
+     */
+    explicit ArrayList(const A &a): alloc(a) {Size = localSize = 0; elem = local = NULL; rear = 0;}
+
+    /**
+     * Constructs an empty array list able to hold initCapacity elements without growing.
+     */
+    explicit ArrayList(int initCapacity, const A &a = A()): alloc(a) {
+        Size = localSize = 0; elem = local = NULL; rear = 0;
+        reserve(initCapacity);
+    }
 
     /**
      * TODO Destructor
      */
-    ~ArrayList() {delete [] elem;}
+    ~ArrayList() {destroy(elem, rear); release(elem, Size);}
 
     /**
      * TODO Assignment operator
      */
     ArrayList& operator=(const ArrayList& x) { //checked
-        if (x == *this) return *this;
-        delete [] elem;
-        Size = x.Size; rear = x.rear;
-        elem = new T[Size];
-        for (int i = 0; i < rear; i ++) elem[i] = x.elem[i];
+        if (&x == this) return *this;
+        destroy(elem, rear); rear = 0;
+        if (Size < x.rear) {release(elem, Size); elem = NULL; Size = 0; reserve(x.rear);}
+        copyTo(elem, x.elem, x.rear, Trivial());
+        rear = x.rear;
         return *this;
     }
 
     /**
      * TODO Copy-constructor
      */
-    ArrayList(const ArrayList& x) {//checked
-        rear = x.rear; Size = x.Size;
-        elem = new T[Size];
-        for (int i = 0; i < rear; i ++) elem[i] = x.elem[i];
+    ArrayList(const ArrayList& x): alloc(x.alloc) {//checked
+        rear = x.rear; Size = x.rear;
+        local = NULL; localSize = 0;
+        elem = allocate(Size);
+        copyTo(elem, x.elem, rear, Trivial());
+    }
+
+    /**
+     * Move-constructor, x is left empty
+     */
+    ArrayList(ArrayList&& x): alloc(x.alloc) {
+        Size = localSize = 0; elem = local = NULL; rear = 0;
+        steal(x);
+    }
+
+    /**
+     * Move assignment operator, x is left empty
+     */
+    ArrayList& operator=(ArrayList&& x) {
+        if (&x == this) return *this;
+        destroy(elem, rear); rear = 0;
+        steal(x);
+        return *this;
+    }
+
+    /**
+     * Constructs an element from args at the end of this list and returns a reference to it.
+     */
+    template <class... Args>
+    T& emplaceBack(Args&&... args) {
+        if (rear == Size) {
+            T tmp(std::forward<Args>(args)...); //args may refer into elem
+            doubleSpace();
+            new (elem + rear) T(std::move(tmp));
+        } else new (elem + rear) T(std::forward<Args>(args)...);
+        return elem[rear++];
+    }
+
+    /**
+     * Constructs an element from args at the specified position in this list.
+     * The range of index parameter is [0, size], the same as add(int, const T&).
+     * @throw IndexOutOfBound
+     */
+    template <class... Args>
+    T& emplace(int index, Args&&... args) {
+        if (index > rear || index < 0) throw IndexOutOfBound("\nIllegal Segment\n");
+        if (index == rear) return emplaceBack(std::forward<Args>(args)...);
+        T tmp(std::forward<Args>(args)...);
+        openGap(index, 1);
+        new (elem + index) T(std::move(tmp));
+        return elem[index];
     }
 
     /**
      * TODO Appends the specified element to the end of this list.
      */
     bool add(const T& e) { //checked
-        if (rear == Size) doubleSpace();
-        elem[rear++] = e;
+        emplaceBack(e);
+        return true;
+    }
+
+    /**
+     * Appends the specified element to the end of this list, moving from it.
+     */
+    bool add(T&& e) {
+        emplaceBack(std::move(e));
         return true;
     }
 
@@ -106,28 +284,90 @@ public:
      * @throw IndexOutOfBound
      */
     void add(int index, const T& element) { //checked
-        if (index >= rear || rear < 0) {throw IndexOutOfBound("\nIllegal Segment\n"); return ;}
-        if (rear == Size) doubleSpace();
-        for (int i = rear; i > index; i --) elem[i] = elem[i - 1]; 
-        elem[index] = element; rear ++;
+        emplace(index, element);
+    }
+
+    /**
+     * Inserts the specified element to the specified position in this list, moving from it.
+     * @throw IndexOutOfBound
+     */
+    void add(int index, T&& element) {
+        emplace(index, std::move(element));
     }
 
     /**
      * TODO Removes all of the elements from this list.
      */
     void clear() {//checked
-        delete [] elem; Size = 1; rear = 0;
-        elem = new T[Size];
+        destroy(elem, rear); release(elem, Size);
+        elem = local; Size = localSize; rear = 0;
     }
 
+    /**
+     * Makes sure that at least n elements fit without further growth.
+     */
+    void reserve(int n) {if (n > Size) reallocate(n);}
+
+    /**
+     * Releases the capacity beyond size().
+     */
+    void shrinkToFit() {if (Size > rear) reallocate(rear);}
+
+    /**
+     * Returns the number of elements the internal array can hold without growing.
+     */
+    int capacity() const {return Size;}
+
     /**
      * TODO Returns true if this list contains the specified element.
      */
     bool contains(const T& e) const {//checked
-        for (int i = 0; i < rear; i ++) if (elem[i] == e) return true;
-        return false;
+        return indexOf(e) != -1;
     }
 
+    /**
+     * Returns the index of the first occurrence of the specified element, or -1 if there is none.
+     * Arithmetic elements are compared with SIMD instructions when the target has them.
+     */
+    int indexOf(const T& e) const {return SimdSearch<T>::indexOf(elem, rear, e);}
+
+    /**
+     * Returns the index of the last occurrence of the specified element, or -1 if there is none.
+     */
+    int lastIndexOf(const T& e) const {return SimdSearch<T>::lastIndexOf(elem, rear, e);}
+
+    /**
+     * Returns the number of occurrences of the specified element.
+     */
+    int count(const T& e) const {return SimdSearch<T>::count(elem, rear, e);}
+
+    /**
+     * Sorts this list into ascending order on the shared ThreadPool.
+     * Integral and 4- or 8-byte floating point elements are radix sorted, everything else is
+     * merge sorted with operator<.
+     */
+    void sort() {sort(typename ParallelAlgorithm::Radixable<T>::type());}
+
+    /**
+     * Sorts this list with the comparator cmp by a stable parallel merge sort.
+     */
+    template <class Cmp>
+    void sort(Cmp cmp) {ParallelAlgorithm::sort(elem, rear, cmp);}
+
+    /**
+     * Calls fn on every element, chunks of the list being processed concurrently.
+     * fn may modify the element it is given but must be safe to call from several threads.
+     */
+    template <class F>
+    void parallelForEach(F fn) {ParallelAlgorithm::forEach(elem, rear, fn);}
+
+    /**
+     * Folds the list into init with the associative op, chunks of the list being folded
+     * concurrently. Elements must convert to R.
+     */
+    template <class R, class Op>
+    R parallelReduce(R init, Op op) const {return ParallelAlgorithm::reduce(static_cast<const T *>(elem), rear, init, op);}
+
     /**
      * TODO Returns a const reference to the element at the specified position in this list.
      * The index is zero-based, with range [0, size).
@@ -150,20 +390,66 @@ public:
      */
     void removeIndex(int index) {//checked
         if (index >= rear || index < 0) throw IndexOutOfBound("\nIllegal Segment\n");
-        for (int i = index; i < rear; i ++){
-            elem[i] = elem[i + 1]; 
-        } 
-        rear --;
+        closeGap(index, 1);
+    }
+
+    /**
+     * Removes the elements in positions [from, to), shifting the tail once.
+     * @throw IndexOutOfBound
+     */
+    void removeRange(int from, int to) {
+        if (from < 0 || to > rear || from > to) throw IndexOutOfBound("\nIllegal Segment\n");
+        if (from < to) closeGap(from, to - from);
+    }
+
+    /**
+     * Removes every element satisfying pred in a single compaction pass, keeping the order
+     * of the rest. Returns the number of elements removed.
+     */
+    template <class Pred>
+    int removeIf(Pred pred) {
+        int j = 0;
+        for (int i = 0; i < rear; i ++) {
+            if (pred(static_cast<const T &>(elem[i]))) continue;
+            if (i != j) elem[j] = std::move(elem[i]);
+            j ++;
+        }
+        int removed = rear - j;
+        destroy(elem + j, removed); rear = j;
+        return removed;
     }
 
+    /**
+     * Inserts the elements of [first, last) to the specified position in this list, with at
+     * most one reallocation and one tail shift. The range must be a forward range and must
+     * not refer into this list.
+     * The range of index parameter is [0, size].
+     * @throw IndexOutOfBound
+     */
+    template <class Iter>
+    void insertRange(int index, Iter first, Iter last) {
+        if (index > rear || index < 0) throw IndexOutOfBound("\nIllegal Segment\n");
+        int n = static_cast<int>(std::distance(first, last));
+        if (n == 0) return;
+        openGap(index, n);
+        for (T *p = elem + index; first != last; ++ first, ++ p) new (p) T(*first);
+    }
+
+    /**
+     * Appends the elements of [first, last) to the end of this list, with at most one reallocation.
+     */
+    template <class Iter>
+    void addAll(Iter first, Iter last) {insertRange(rear, first, last);}
+
     /**
      * TODO Removes the first occurrence of the specified element from this list, if it is present.
      * Returns true if it is present in the list, otherwise false.
      */
     bool remove(const T &e) {//checked
-        for (int i = 0; i < rear; i ++)
-            if (elem[i] == e) {removeIndex(i); return true;}
-        return false;
+        int i = indexOf(e);
+        if (i == -1) return false;
+        removeIndex(i);
+        return true;
     }
 
     /**
@@ -181,14 +467,44 @@ public:
      */
     int size() const {return rear;}//checked
 
+    /**
+     * Returns the allocator of this list.
+     */
+    A getAllocator() const {return alloc;}
+
     /**
      * TODO Returns an iterator over the elements in this list.
      */
     Iterator iterator() {
         Iterator itr;
-        itr.init(0, this, rear, Size, -1);
+        itr.init(this);
         return itr; 
     }
+
+    /**
+     * Returns an unchecked random-access iterator to the first element, for range-for and
+     * <algorithm>. Iterators are invalidated by anything that reallocates the list.
+     */
+    T *begin() {return elem;}
+    const T *begin() const {return elem;}
+
+    /**
+     * Returns the iterator past the last element.
+     */
+    T *end() {return elem + rear;}
+    const T *end() const {return elem + rear;}
+
+    /**
+     * Returns the internal array, holding size() elements.
+     */
+    T *data() {return elem;}
+    const T *data() const {return elem;}
+
+    /**
+     * Returns a view of the elements, see ArraySpan.
+     */
+    ArraySpan<T> span() {return ArraySpan<T>(elem, rear);}
+    ArraySpan<const T> span() const {return ArraySpan<const T>(elem, rear);}
 };
 
 #endif
@@ -0,0 +1,36 @@
+/** @file */
+#ifndef __ARRAYSPAN_H
+#define __ARRAYSPAN_H
+
+#include <cstddef>
+
+/**
+ * ArraySpan is a non-owning view of a contiguous run of elements, like std::span.
+ *
+ * Indexing is not bounds-checked and the iterators are plain pointers, so loops over a span
+ * compile to pointer increments and work with range-for and <algorithm>. A span taken from a
+ * list is invalidated by anything that reallocates the list.
+ */
+template <class T>
+class ArraySpan
+{
+    T *ptr;
+    int len;
+public:
+    ArraySpan(): ptr(NULL), len(0) {}
+    ArraySpan(T *_p, int _l): ptr(_p), len(_l) {}
+
+    T *begin() const {return ptr;}
+    T *end() const {return ptr + len;}
+    T *data() const {return ptr;}
+    int size() const {return len;}
+    bool isEmpty() const {return len == 0;}
+    T &operator[](int index) const {return ptr[index];}
+
+    /**
+     * Returns the view of the count elements starting at offset.
+     */
+    ArraySpan subspan(int offset, int count) const {return ArraySpan(ptr + offset, count);}
+};
+
+#endif
@@ -0,0 +1,143 @@
+/** @file */
+#ifndef __BLOOMFILTER_H
+#define __BLOOMFILTER_H
+
+#include "Allocator.h"
+#include "HashFunctions.h"
+#include <cstddef>
+#include <cstring>
+
+/**
+ * BloomFilter is a blocked Bloom filter over 64-bit hashes: a set that may answer "maybe"
+ * for a hash that was never added, but never "no" for one that was.
+ *
+ * The bits are split into blocks of one 64-byte cache line each. A hash picks one block
+ * and sets Hashes bits inside it, so add() and mayContain() touch a single cache line. The
+ * filter is sized for capacity() hashes at BitsPerKey bits each, which gives about 1% false
+ * positives at full load; past that the rate climbs, and the owner is expected to rebuild
+ * it larger with reset().
+ *
+ * Hashes cannot be taken out again. A container that removes keys leaves their bits set,
+ * which only costs false positives, and rebuilds the filter from its remaining keys once
+ * size(), the number of hashes added since the last reset, passes capacity().
+ *
+ * Memory comes from the allocator A, see Allocator.h.
+ */
+template <class A = HeapAllocator>
+class BloomFilter
+{
+    static const int BlockWords = 8;
+    static const int Hashes = 7;
+    static const int BitsPerKey = 10;
+
+    //words is raw rounded up to a cache line
+    void *raw;
+    unsigned long long *words;
+    int blocks, cap, items;
+    A alloc;
+
+    static size_t rawBytes(int blocks) {return sizeof(unsigned long long) * BlockWords * blocks + 64;}
+
+    void allocate(int expected) {
+        cap = expected > 64 * BlockWords / BitsPerKey ? expected : 64 * BlockWords / BitsPerKey;
+        blocks = (int)(((long long)cap * BitsPerKey + 64 * BlockWords - 1) / (64 * BlockWords));
+        raw = alloc.allocate(rawBytes(blocks));
+        words = reinterpret_cast<unsigned long long *>(((size_t)raw + 63) & ~(size_t)63);
+        clear();
+    }
+    void release() {alloc.deallocate(raw, rawBytes(blocks));}
+
+    //the first word of the block of the mixed hash x, picked by its high half. The low half
+    //gives the bits inside the block, first + i * step mod 512 for i < Hashes
+    size_t blockOf(unsigned long long x) const {
+        return (size_t)(((x >> 32) * (unsigned long long)blocks) >> 32) * BlockWords;
+    }
+
+public:
+    /**
+     * Constructs an empty filter sized for expected hashes.
+     */
+    explicit BloomFilter(int expected = 0, const A &a = A()): alloc(a) {allocate(expected);}
+
+    /**
+     * Copy-constructor
+     */
+    BloomFilter(const BloomFilter &x): alloc(x.alloc) {
+        allocate(x.cap);
+        std::memcpy(words, x.words, sizeof(unsigned long long) * BlockWords * blocks);
+        items = x.items;
+    }
+
+    /**
+     * Assignment operator
+     */
+    BloomFilter &operator=(const BloomFilter &x) {
+        if (&x == this) return *this;
+        release();
+        allocate(x.cap);
+        std::memcpy(words, x.words, sizeof(unsigned long long) * BlockWords * blocks);
+        items = x.items;
+        return *this;
+    }
+
+    /**
+     * Destructor
+     */
+    ~BloomFilter() {release();}
+
+    /**
+     * Adds the hash h.
+     */
+    void add(unsigned long long h) {
+        unsigned long long x = mix64(h);
+        unsigned long long *b = words + blockOf(x);
+        unsigned int first = x & 0xFFFF, step = (x >> 16 & 0xFFFF) | 1;
+        for (int i = 0; i < Hashes; i ++, first += step) b[first >> 6 & 7] |= 1ULL << (first & 63);
+        items ++;
+    }
+
+    /**
+     * Returns false if h was certainly never added since the last reset, true otherwise.
+     */
+    bool mayContain(unsigned long long h) const {
+        unsigned long long x = mix64(h);
+        const unsigned long long *b = words + blockOf(x);
+        unsigned int first = x & 0xFFFF, step = (x >> 16 & 0xFFFF) | 1;
+        for (int i = 0; i < Hashes; i ++, first += step)
+            if (!(b[first >> 6 & 7] >> (first & 63) & 1)) return false;
+        return true;
+    }
+
+    /**
+     * Removes every hash, keeping the size of the filter.
+     */
+    void clear() {
+        std::memset(words, 0, sizeof(unsigned long long) * BlockWords * blocks);
+        items = 0;
+    }
+
+    /**
+     * Removes every hash and resizes the filter for expected hashes.
+     */
+    void reset(int expected) {
+        release();
+        allocate(expected);
+    }
+
+    /**
+     * Returns the number of hashes added since the last clear() or reset().
+     */
+    int size() const {return items;}
+
+    /**
+     * Returns the number of hashes the filter is sized for.
+     */
+    int capacity() const {return cap;}
+
+    /**
+     * Returns the allocator of this filter.
+     */
+    A getAllocator() const {return alloc;}
+};
+
+#endif
@@ -0,0 +1,191 @@
+/** @file */
+#ifndef __CONCURRENTAPPENDLIST_H
+#define __CONCURRENTAPPENDLIST_H
+
+#include "IndexOutOfBound.h"
+#include "ElementNotExist.h"
+#include "Allocator.h"
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <utility>
+
+/**
+ * ConcurrentAppendList is an append-only list that many threads may add to and read from
+ * at the same time without locks.
+ *
+ * The elements live in segments of 32, 64, 128, ... slots that are allocated on demand and
+ * never move, so growing never copies an element. add() reserves its slot with one
+ * fetch_add, constructs the element in place and then marks the slot as published. get()
+ * is wait-free. size() and the iterator cover the published prefix, i.e. the longest run
+ * of published slots from index 0; an element whose add() is still running hides the
+ * elements after it from them, though get() can already see those.
+ *
+ * Segments are allocated concurrently, so A has to be thread-safe (HeapAllocator is).
+ * The destructor must not race with other calls.
+ */
+template <class T, class A = HeapAllocator>
+class ConcurrentAppendList
+{
+    static_assert(alignof(T) <= alignof(std::max_align_t), "over-aligned element type");
+
+    static const int FirstShift = 5;
+    //enough segments for every non-negative int index short of the last 32
+    static const int Segments = 31 - FirstShift;
+
+    //a segment is the array of ready flags followed by the array of elements
+    static size_t flagBytes(int n) {
+        size_t a = alignof(std::max_align_t);
+        return (sizeof(std::atomic<bool>) * n + a - 1) / a * a;
+    }
+    static size_t segmentBytes(int k) {
+        int n = segmentSize(k);
+        return flagBytes(n) + sizeof(T) * n;
+    }
+    static int segmentSize(int k) {return 1 << (k + FirstShift);}
+    static std::atomic<bool> *flags(char *seg) {return reinterpret_cast<std::atomic<bool> *>(seg);}
+    static T *slots(char *seg, int k) {return reinterpret_cast<T *>(seg + flagBytes(segmentSize(k)));}
+
+    //maps an index to its segment and the offset inside it
+    static void locate(int i, int &k, int &off) {
+        unsigned j = (unsigned)i + (1u << FirstShift);
+        k = 31 - __builtin_clz(j) - FirstShift;
+        off = j - (1u << (k + FirstShift));
+    }
+
+    std::atomic<char *> seg[Segments];
+    alignas(64) std::atomic<int> tail;
+    alignas(64) mutable std::atomic<int> published;
+    A alloc;
+
+    char *segment(int k) {
+        char *s = seg[k].load(std::memory_order_acquire);
+        if (s != NULL) return s;
+        char *fresh = static_cast<char *>(alloc.allocate(segmentBytes(k)));
+        std::atomic<bool> *f = flags(fresh);
+        for (int i = 0; i < segmentSize(k); i ++) new (f + i) std::atomic<bool>(false);
+        if (seg[k].compare_exchange_strong(s, fresh, std::memory_order_acq_rel)) return fresh;
+        alloc.deallocate(fresh, segmentBytes(k));
+        return s;
+    }
+
+    bool ready(int i) const {
+        int k, off;
+        locate(i, k, off);
+        char *s = seg[k].load(std::memory_order_acquire);
+        return s != NULL && flags(s)[off].load(std::memory_order_acquire);
+    }
+
+    ConcurrentAppendList(const ConcurrentAppendList &);
+    ConcurrentAppendList &operator=(const ConcurrentAppendList &);
+public:
+    class Iterator
+    {
+        const ConcurrentAppendList *arr;
+        int pos, rear;
+    public:
+        void init(const ConcurrentAppendList *_a){arr = _a; pos = 0; rear = _a->size();}
+        /**
+         * Returns true if the iteration has more elements. The iteration covers the
+         * elements published when the iterator was created.
+         */
+        bool hasNext() {return pos < rear;}
+
+        /**
+         * Returns the next element in the iteration.
+         * @throw ElementNotExist exception when hasNext() == false
+         */
+        const T &next() {
+            if (!hasNext()) throw ElementNotExist("\nNo Such Element\n");
+            return arr->get(pos ++);
+        }
+    };
+
+    /**
+     * Constructs an empty list.
+     */
+    ConcurrentAppendList(const A &a = A()): tail(0), published(0), alloc(a) {
+        for (int k = 0; k < Segments; k ++) seg[k].store(NULL, std::memory_order_relaxed);
+    }
+
+    /**
+     * Destructor
+     */
+    ~ConcurrentAppendList() {
+        int n = tail.load();
+        for (int k = 0; k < Segments; k ++) {
+            char *s = seg[k].load();
+            if (s == NULL) continue;
+            int base = segmentSize(k) - (1 << FirstShift);
+            for (int off = 0; off < segmentSize(k) && base + off < n; off ++)
+                if (flags(s)[off].load()) slots(s, k)[off].~T();
+            alloc.deallocate(s, segmentBytes(k));
+        }
+    }
+
+    /**
+     * Constructs an element from args in the next free slot and returns its index.
+     */
+    template <class... Args>
+    int emplaceBack(Args&&... args) {
+        int i = tail.fetch_add(1, std::memory_order_relaxed);
+        int k, off;
+        locate(i, k, off);
+        char *s = segment(k);
+        new (slots(s, k) + off) T(std::forward<Args>(args)...);
+        flags(s)[off].store(true, std::memory_order_release);
+        int p = published.load(std::memory_order_relaxed);
+        if (p == i) size();
+        return i;
+    }
+
+    /**
+     * Appends the specified element to the end of this list.
+     */
+    bool add(const T &e) {emplaceBack(e); return true;}
+
+    /**
+     * Appends the specified element to the end of this list, moving from it.
+     */
+    bool add(T &&e) {emplaceBack(std::move(e)); return true;}
+
+    /**
+     * Returns a const reference to the element at the specified index. Wait-free.
+     * @throw IndexOutOfBound if no element has been published at index
+     */
+    const T &get(int index) const {
+        if (index < 0 || index >= tail.load(std::memory_order_relaxed)) throw IndexOutOfBound("\nIllegal Segment\n");
+        int k, off;
+        locate(index, k, off);
+        char *s = seg[k].load(std::memory_order_acquire);
+        if (s == NULL || !flags(s)[off].load(std::memory_order_acquire)) throw IndexOutOfBound("\nIllegal Segment\n");
+        return slots(s, k)[off];
+    }
+
+    /**
+     * Returns the length of the published prefix.
+     */
+    int size() const {
+        int p = published.load(std::memory_order_acquire), q = p;
+        int n = tail.load(std::memory_order_acquire);
+        while (q < n && ready(q)) q ++;
+        while (q > p && !published.compare_exchange_weak(p, q, std::memory_order_acq_rel));
+        return q > p ? q : p;
+    }
+
+    /**
+     * Returns true if no element has been published.
+     */
+    bool isEmpty() const {return size() == 0;}
+
+    /**
+     * Returns an iterator over the published prefix.
+     */
+    Iterator iterator() const {
+        Iterator itr;
+        itr.init(this);
+        return itr;
+    }
+};
+
+#endif
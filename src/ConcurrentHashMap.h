@@ -0,0 +1,379 @@
+/** @file */
+#ifndef __CONCURRENTHASHMAP_H
+#define __CONCURRENTHASHMAP_H
+
+#include "ElementNotExist.h"
+#include "Allocator.h"
+#include "HashFunctions.h"
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+
+/**
+ * ConcurrentHashMap is a hash map that many threads may read and write at the same time.
+ * H follows the same hashCode contract as for HashMap, including the optional hash64.
+ *
+ * Keys are spread over Shards independent shards by the top bits of their mixed hash. Each
+ * shard is a chained hash table with its own mutex and grows on its own, so writers, and a
+ * resize, only ever hold up the keys of one shard.
+ *
+ * When K and V are trivially copyable, get() takes no lock: every write to a shard bumps
+ * a sequence counter before and after, and a reader walks the chain optimistically and
+ * retries if the counter moved meanwhile. For that to be safe, nodes are never freed
+ * while the map lives: removed nodes go to a free list of their shard and are reused, and
+ * outgrown bucket arrays are kept until destruction. Other key and value types are read
+ * under the shard mutex.
+ *
+ * Memory comes from the allocator A, from several threads at once, so A has to be
+ * thread-safe (HeapAllocator is). The destructor must not race with other calls.
+ */
+template <class K, class V, class H, class A = HeapAllocator>
+class ConcurrentHashMap
+{
+    static const int ShardBits = 6;
+    static const int Shards = 1 << ShardBits;
+    static const int D_cap = 16;
+
+    typedef std::integral_constant<bool, std::is_trivially_copyable<K>::value && std::is_trivially_copyable<V>::value> Optimistic;
+
+    struct Node{
+        std::atomic<Node *> nxt;
+        unsigned int hash;
+        K key;
+        V value;
+        Node(const K &k, const V &v, unsigned int h): nxt(NULL), hash(h), key(k), value(v) {}
+    };
+
+    //a bucket array, the slots follow the header
+    struct Table{
+        int mask;
+        Table *older;
+        std::atomic<Node *> *slot() {return reinterpret_cast<std::atomic<Node *> *>(this + 1);}
+    };
+
+    struct alignas(64) Shard{
+        std::mutex lock;
+        std::atomic<unsigned int> seq;
+        std::atomic<Table *> table;
+        std::atomic<int> sz;
+        Node *freeNodes;
+    };
+
+    Shard shards[Shards];
+    A alloc;
+
+    static unsigned int mix(const K &key) {
+        if (WideHash<H, K>::value) {unsigned long long x = hashOf<H>(key); return x ^ (x >> 32);}
+        unsigned int h = H::hashCode(key);
+        h ^= h >> 16; h *= 0x85ebca6bu;
+        h ^= h >> 13; h *= 0xc2b2ae35u;
+        h ^= h >> 16;
+        return h;
+    }
+
+    Shard &shardOf(unsigned int h) {return shards[h >> (32 - ShardBits)];}
+    const Shard &shardOf(unsigned int h) const {return shards[h >> (32 - ShardBits)];}
+
+    static size_t tableBytes(int n) {return sizeof(Table) + sizeof(std::atomic<Node *>) * n;}
+
+    Table *newTable(int n, Table *older) {
+        static_assert(sizeof(Table) % alignof(std::atomic<Node *>) == 0, "misaligned slots");
+        Table *t = static_cast<Table *>(alloc.allocate(tableBytes(n)));
+        t->mask = n - 1; t->older = older;
+        for (int i = 0; i < n; i ++) new (t->slot() + i) std::atomic<Node *>(NULL);
+        return t;
+    }
+
+    //takes a node from the free list of s, or a fresh one
+    Node *newNode(Shard &s, const K &key, const V &value, unsigned int h) {
+        void *p = s.freeNodes;
+        if (p != NULL) s.freeNodes = s.freeNodes->nxt.load(std::memory_order_relaxed);
+            else p = alloc.allocate(sizeof(Node));
+        try {
+            return new (p) Node(key, value, h);
+        } catch (...) {
+            alloc.deallocate(p, sizeof(Node));
+            throw;
+        }
+    }
+    //destroys the contents of e and keeps its memory on the free list of s
+    void recycle(Shard &s, Node *e) {
+        e->~Node();
+        new (&e->nxt) std::atomic<Node *>(s.freeNodes);
+        s.freeNodes = e;
+    }
+
+    //a write section, optimistic readers of the shard retry if they overlap one
+    static void beginWrite(Shard &s) {
+        s.seq.store(s.seq.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+    static void endWrite(Shard &s) {
+        s.seq.store(s.seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    //returns the node holding key in s, only while the mutex of s is held
+    static Node *findLocked(const Shard &s, const K &key, unsigned int h) {
+        Table *t = s.table.load(std::memory_order_relaxed);
+        for (Node *e = t->slot()[h & t->mask].load(std::memory_order_relaxed); e != NULL; e = e->nxt.load(std::memory_order_relaxed))
+            if (e->hash == h && e->key == key) return e;
+        return NULL;
+    }
+
+    //links a new node for key into s, growing it first if it is full. The mutex of s must be
+    //held and key must not be present
+    void insertLocked(Shard &s, const K &key, const V &value, unsigned int h) {
+        Table *t = s.table.load(std::memory_order_relaxed);
+        if (s.sz.load(std::memory_order_relaxed) + 1 > (t->mask + 1) / 4 * 3) grow(s);
+        Node *e = newNode(s, key, value, h);
+        t = s.table.load(std::memory_order_relaxed);
+        std::atomic<Node *> &b = t->slot()[h & t->mask];
+        beginWrite(s);
+        e->nxt.store(b.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        b.store(e, std::memory_order_release);
+        endWrite(s);
+        s.sz.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    //doubles the bucket array of s, the mutex of s must be held
+    void grow(Shard &s) {
+        Table *t = s.table.load(std::memory_order_relaxed);
+        Table *n = newTable(2 * (t->mask + 1), t);
+        beginWrite(s);
+        for (int i = 0; i <= t->mask; i ++){
+            Node *e = t->slot()[i].load(std::memory_order_relaxed);
+            while (e != NULL){
+                Node *nxt = e->nxt.load(std::memory_order_relaxed);
+                std::atomic<Node *> &b = n->slot()[e->hash & n->mask];
+                e->nxt.store(b.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                b.store(e, std::memory_order_relaxed);
+                e = nxt;
+            }
+        }
+        s.table.store(n, std::memory_order_release);
+        endWrite(s);
+    }
+
+    bool read(const Shard &s, const K &key, unsigned int h, V &out, std::true_type) const {
+        for (int spins = 0; ; spins ++){
+            unsigned int q = s.seq.load(std::memory_order_acquire);
+            if (q & 1) {if (spins > 64) std::this_thread::yield(); continue;}
+            Table *t = s.table.load(std::memory_order_acquire);
+            bool found = false;
+            int steps = 0;
+            for (Node *e = t->slot()[h & t->mask].load(std::memory_order_acquire); e != NULL; e = e->nxt.load(std::memory_order_acquire)){
+                if (e->hash == h && e->key == key) {out = e->value; found = true; break;}
+                //a chain relinked under our feet can cycle, stop walking it once we know
+                if (++ steps % 64 == 0 && s.seq.load(std::memory_order_relaxed) != q) break;
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (s.seq.load(std::memory_order_relaxed) == q) return found;
+        }
+    }
+    bool read(const Shard &s, const K &key, unsigned int h, V &out, std::false_type) const {
+        std::lock_guard<std::mutex> g(const_cast<Shard &>(s).lock);
+        Node *e = findLocked(s, key, h);
+        if (e == NULL) return false;
+        out = e->value;
+        return true;
+    }
+
+    //frees every node of s, live or on the free list, and all its bucket arrays
+    void releaseShard(Shard &s) {
+        Table *t = s.table.load();
+        for (int i = 0; i <= t->mask; i ++){
+            Node *e = t->slot()[i].load();
+            while (e != NULL){
+                Node *nxt = e->nxt.load();
+                e->~Node();
+                alloc.deallocate(e, sizeof(Node));
+                e = nxt;
+            }
+        }
+        while (s.freeNodes != NULL){
+            Node *nxt = s.freeNodes->nxt.load();
+            alloc.deallocate(s.freeNodes, sizeof(Node));
+            s.freeNodes = nxt;
+        }
+        while (t != NULL){
+            Table *older = t->older;
+            alloc.deallocate(t, tableBytes(t->mask + 1));
+            t = older;
+        }
+    }
+
+    ConcurrentHashMap(const ConcurrentHashMap &);
+    ConcurrentHashMap &operator=(const ConcurrentHashMap &);
+public:
+    /**
+     * Constructs an empty map.
+     */
+    ConcurrentHashMap(const A &a = A()): alloc(a) {
+        for (int i = 0; i < Shards; i ++){
+            shards[i].seq.store(0, std::memory_order_relaxed);
+            shards[i].table.store(newTable(D_cap, NULL), std::memory_order_relaxed);
+            shards[i].sz.store(0, std::memory_order_relaxed);
+            shards[i].freeNodes = NULL;
+        }
+    }
+
+    /**
+     * Destructor
+     */
+    ~ConcurrentHashMap() {
+        for (int i = 0; i < Shards; i ++) releaseShard(shards[i]);
+    }
+
+    /**
+     * Copies the value mapped to key into out and returns true, or returns false if the key
+     * is not present. Lock-free for trivially copyable K and V.
+     */
+    bool find(const K &key, V &out) const {
+        unsigned int h = mix(key);
+        return read(shardOf(h), key, h, out, Optimistic());
+    }
+
+    /**
+     * Returns a copy of the value to which the specified key is mapped.
+     * @throw ElementNotExist
+     */
+    V get(const K &key) const {
+        V v;
+        if (!find(key, v)) throw ElementNotExist("\nNo Such Element.\n");
+        return v;
+    }
+
+    /**
+     * Returns true if this map contains a mapping for the specified key.
+     */
+    bool containsKey(const K &key) const {
+        V v;
+        return find(key, v);
+    }
+
+    /**
+     * Associates the specified value with the specified key in this map.
+     */
+    void put(const K &key, const V &value) {
+        unsigned int h = mix(key);
+        Shard &s = shardOf(h);
+        std::lock_guard<std::mutex> g(s.lock);
+        Node *e = findLocked(s, key, h);
+        if (e != NULL) {
+            beginWrite(s);
+            e->value = value;
+            endWrite(s);
+            return;
+        }
+        insertLocked(s, key, value, h);
+    }
+
+    /**
+     * Associates the specified value with the specified key if the key is not present yet.
+     * Returns true if the value was inserted.
+     */
+    bool putIfAbsent(const K &key, const V &value) {
+        unsigned int h = mix(key);
+        Shard &s = shardOf(h);
+        std::lock_guard<std::mutex> g(s.lock);
+        if (findLocked(s, key, h) != NULL) return false;
+        insertLocked(s, key, value, h);
+        return true;
+    }
+
+    /**
+     * Removes the mapping for the specified key from this map if present.
+     * Returns true if there was one, otherwise false.
+     */
+    bool tryRemove(const K &key) {
+        unsigned int h = mix(key);
+        Shard &s = shardOf(h);
+        std::lock_guard<std::mutex> g(s.lock);
+        Table *t = s.table.load(std::memory_order_relaxed);
+        std::atomic<Node *> *link = &t->slot()[h & t->mask];
+        for (Node *e = link->load(std::memory_order_relaxed); e != NULL; link = &e->nxt, e = link->load(std::memory_order_relaxed)){
+            if (e->hash == h && e->key == key){
+                beginWrite(s);
+                link->store(e->nxt.load(std::memory_order_relaxed), std::memory_order_release);
+                endWrite(s);
+                s.sz.fetch_sub(1, std::memory_order_relaxed);
+                recycle(s, e);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * Removes the mapping for the specified key from this map if present.
+     * @throw ElementNotExist
+     */
+    void remove(const K &key) {
+        if (!tryRemove(key)) throw ElementNotExist("\nNo Such Element.\n");
+    }
+
+    /**
+     * Removes all of the mappings from this map, one shard at a time.
+     */
+    void clear() {
+        for (int i = 0; i < Shards; i ++){
+            Shard &s = shards[i];
+            std::lock_guard<std::mutex> g(s.lock);
+            Table *t = s.table.load(std::memory_order_relaxed);
+            Node *chain = NULL;
+            beginWrite(s);
+            for (int j = 0; j <= t->mask; j ++){
+                Node *e = t->slot()[j].load(std::memory_order_relaxed);
+                t->slot()[j].store(NULL, std::memory_order_relaxed);
+                while (e != NULL){
+                    Node *nxt = e->nxt.load(std::memory_order_relaxed);
+                    e->nxt.store(chain, std::memory_order_relaxed);
+                    chain = e; e = nxt;
+                }
+            }
+            endWrite(s);
+            s.sz.store(0, std::memory_order_relaxed);
+            while (chain != NULL){
+                Node *nxt = chain->nxt.load(std::memory_order_relaxed);
+                recycle(s, chain);
+                chain = nxt;
+            }
+        }
+    }
+
+    /**
+     * Calls fn(key, value) for every mapping, locking one shard at a time. Mappings added
+     * or removed meanwhile in other shards may or may not be seen.
+     */
+    template <class F>
+    void forEach(F fn) const {
+        for (int i = 0; i < Shards; i ++){
+            Shard &s = const_cast<Shard &>(shards[i]);
+            std::lock_guard<std::mutex> g(s.lock);
+            Table *t = s.table.load(std::memory_order_relaxed);
+            for (int j = 0; j <= t->mask; j ++)
+                for (Node *e = t->slot()[j].load(std::memory_order_relaxed); e != NULL; e = e->nxt.load(std::memory_order_relaxed))
+                    fn(e->key, e->value);
+        }
+    }
+
+    /**
+     * Returns the number of key-value mappings in this map. Not a snapshot while other
+     * threads write.
+     */
+    int size() const {
+        int n = 0;
+        for (int i = 0; i < Shards; i ++) n += shards[i].sz.load(std::memory_order_relaxed);
+        return n;
+    }
+
+    /**
+     * Returns true if this map contains no key-value mappings.
+     */
+    bool isEmpty() const {return size() == 0;}
+};
+
+#endif
@@ -0,0 +1,315 @@
+/** @file */
+#ifndef __FLATHASHMAP_H
+#define __FLATHASHMAP_H
+
+#include "ElementNotExist.h"
+#include "Allocator.h"
+#include "HashFunctions.h"
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <utility>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/**
+ * FlatHashMap is a map implemented by open addressing in the style of Swiss tables.
+ * It has the same contract as HashMap, including the H parameter, but keeps its entries in
+ * one flat slot array instead of one heap node per entry.
+ *
+ * Next to the slots sits an array of control bytes, one per slot: empty, deleted, or the
+ * low 7 bits of the hash of the key stored in the slot. Slots are probed in aligned groups
+ * of 16; the control bytes of a group are compared with the wanted 7 bits all at once
+ * (with SSE2 where available), and keys are only compared for the slots that match. A probe
+ * ends at the first group holding an empty slot, and the table is kept at most 7/8 full.
+ * Groups are visited in triangular order, which reaches every group, so a degenerate hash
+ * function that maps every key to the same code still works, just slowly.
+ *
+ * The hash code from H is run through a 64-bit finalizer before use, so H need not spread
+ * its bits well. If H has a hash64, see HashFunctions.h, its full 64 bits are used as they
+ * are. Memory comes from the allocator A, see Allocator.h; an empty map owns no
+ * memory.
+ *
+ * The order of iteration is arbitrary. Each (key, value) pair is iterated exactly once.
+ */
+template <class K, class V, class H, class A = HeapAllocator>
+class FlatHashMap
+{
+public:
+    class Entry
+    {
+        K key;
+        V value;
+    public:
+        Entry(const K &k, const V &v): key(k), value(v) {}
+
+        const K &getKey() const
+        {
+            return key;
+        }
+
+        const V &getValue() const
+        {
+            return value;
+        }
+
+        V &getValue2()
+        {
+            return value;
+        }
+    };
+
+private:
+    static const signed char Empty = -128;
+    static const signed char Deleted = -2;
+    static const int Width = 16;
+
+    //bit i of the results stands for slot i of the group
+    struct Group
+    {
+#ifdef __SSE2__
+        __m128i ctrl;
+        explicit Group(const signed char *p): ctrl(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p))) {}
+        unsigned match(signed char h2) const {return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), ctrl));}
+        unsigned matchEmpty() const {return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(Empty), ctrl));}
+        unsigned matchFree() const {return _mm_movemask_epi8(_mm_cmpgt_epi8(_mm_set1_epi8(-1), ctrl));}
+#else
+        const signed char *ctrl;
+        explicit Group(const signed char *p): ctrl(p) {}
+        unsigned match(signed char h2) const {
+            unsigned m = 0;
+            for (int i = 0; i < Width; i ++) if (ctrl[i] == h2) m |= 1u << i;
+            return m;
+        }
+        unsigned matchEmpty() const {return match(Empty);}
+        unsigned matchFree() const {
+            unsigned m = 0;
+            for (int i = 0; i < Width; i ++) if (ctrl[i] < -1) m |= 1u << i;
+            return m;
+        }
+#endif
+    };
+
+    signed char *ctrl;
+    Entry *slots;
+    int cap, sz, growthLeft;
+    A alloc;
+
+    static signed char h2(unsigned long long h) {return h & 0x7F;}
+    static int maxLoad(int c) {return c - c / 8;}
+
+    static size_t ctrlBytes(int c) {
+        size_t a = alignof(Entry) > Width ? alignof(Entry) : Width;
+        return (c + a - 1) / a * a;
+    }
+    static size_t blockBytes(int c) {return ctrlBytes(c) + sizeof(Entry) * c;}
+
+    void allocate(int c) {
+        char *p = static_cast<char *>(alloc.allocate(blockBytes(c)));
+        ctrl = reinterpret_cast<signed char *>(p);
+        slots = reinterpret_cast<Entry *>(p + ctrlBytes(c));
+        std::memset(ctrl, Empty, c);
+        cap = c; growthLeft = maxLoad(c);
+    }
+    void release() {
+        if (ctrl == NULL) return;
+        for (int i = 0; i < cap; i ++) if (ctrl[i] >= 0) slots[i].~Entry();
+        alloc.deallocate(ctrl, blockBytes(cap));
+        ctrl = NULL; slots = NULL; cap = 0; growthLeft = 0;
+    }
+
+    //returns the slot holding key, or -1
+    int find(const K &key) const {
+        if (ctrl == NULL) return -1;
+        unsigned long long h = hashOf<H>(key);
+        int mask = cap / Width - 1, g = (h >> 7) & mask;
+        for (int step = 1; ; g = (g + step ++) & mask) {
+            Group grp(ctrl + g * Width);
+            for (unsigned m = grp.match(h2(h)); m; m &= m - 1) {
+                int i = g * Width + __builtin_ctz(m);
+                if (slots[i].getKey() == key) return i;
+            }
+            if (grp.matchEmpty()) return -1;
+        }
+    }
+
+    //returns the first empty or deleted slot on the probe sequence of h
+    int findFree(unsigned long long h) const {
+        int mask = cap / Width - 1, g = (h >> 7) & mask;
+        for (int step = 1; ; g = (g + step ++) & mask) {
+            unsigned m = Group(ctrl + g * Width).matchFree();
+            if (m) return g * Width + __builtin_ctz(m);
+        }
+    }
+
+    void rehash(int newCap) {
+        signed char *oc = ctrl;
+        Entry *os = slots;
+        int ocap = cap;
+        allocate(newCap);
+        for (int i = 0; i < ocap; i ++) {
+            if (oc[i] < 0) continue;
+            unsigned long long h = hashOf<H>(os[i].getKey());
+            int j = findFree(h);
+            ctrl[j] = h2(h);
+            new (slots + j) Entry(std::move(os[i]));
+            os[i].~Entry();
+        }
+        growthLeft -= sz;
+        if (oc != NULL) alloc.deallocate(oc, blockBytes(ocap));
+    }
+
+    void copyFrom(const FlatHashMap &x) {
+        ctrl = NULL; slots = NULL; cap = 0; sz = 0; growthLeft = 0;
+        if (x.ctrl == NULL) return;
+        allocate(x.cap);
+        std::memcpy(ctrl, x.ctrl, cap);
+        for (int i = 0; i < cap; i ++) if (ctrl[i] >= 0) new (slots + i) Entry(x.slots[i]);
+        sz = x.sz; growthLeft = x.growthLeft;
+    }
+
+public:
+    class Iterator
+    {
+        const FlatHashMap *map;
+        int idx;
+    public:
+        void init(const FlatHashMap *_m){map = _m; idx = 0;}
+        /**
+         * Returns true if the iteration has more elements.
+         */
+        bool hasNext() {
+            while (idx < map->cap && map->ctrl[idx] < 0) idx ++;
+            return idx < map->cap;
+        }
+
+        /**
+         * Returns the next element in the iteration.
+         * @throw ElementNotExist exception when hasNext() == false
+         */
+        const Entry &next() {
+            if (!hasNext()) throw ElementNotExist("\nNo Such Element.\n");
+            return map->slots[idx ++];
+        }
+    };
+
+    /**
+     * Constructs an empty hash map.
+     */
+    FlatHashMap() {ctrl = NULL; slots = NULL; cap = sz = growthLeft = 0;}
+
+    /**
+     * Constructs an empty hash map drawing memory from the allocator a.
+     */
+    explicit FlatHashMap(const A &a): alloc(a) {ctrl = NULL; slots = NULL; cap = sz = growthLeft = 0;}
+
+    /**
+     * Destructor
+     */
+    ~FlatHashMap() {release();}
+
+    /**
+     * Assignment operator
+     */
+    FlatHashMap &operator=(const FlatHashMap &x) {
+        if (&x == this) return *this;
+        release();
+        copyFrom(x);
+        return *this;
+    }
+
+    /**
+     * Copy-constructor
+     */
+    FlatHashMap(const FlatHashMap &x): alloc(x.alloc) {copyFrom(x);}
+
+    /**
+     * Returns an iterator over the elements in this map.
+     */
+    Iterator iterator() const {
+        Iterator iter;
+        iter.init(this);
+        return iter;
+    }
+
+    /**
+     * Removes all of the mappings from this map and gives back its memory.
+     */
+    void clear() {release(); sz = 0;}
+
+    /**
+     * Returns true if this map contains a mapping for the specified key.
+     */
+    bool containsKey(const K &key) const {return find(key) != -1;}
+
+    /**
+     * Returns true if this map maps one or more keys to the specified value.
+     */
+    bool containsValue(const V &value) const {
+        for (int i = 0; i < cap; i ++) if (ctrl[i] >= 0 && slots[i].getValue() == value) return true;
+        return false;
+    }
+
+    /**
+     * Returns a const reference to the value to which the specified key is mapped.
+     * @throw ElementNotExist
+     */
+    const V &get(const K &key) const {
+        int i = find(key);
+        if (i == -1) throw ElementNotExist("\nNo Such Element.\n");
+        return slots[i].getValue();
+    }
+
+    /**
+     * Returns true if this map contains no key-value mappings.
+     */
+    bool isEmpty() const {return sz == 0;}
+
+    /**
+     * Associates the specified value with the specified key in this map.
+     */
+    void put(const K &key, const V &value) {
+        int i = find(key);
+        if (i != -1) {slots[i].getValue2() = value; return;}
+        if (ctrl == NULL) allocate(Width);
+        unsigned long long h = hashOf<H>(key);
+        i = findFree(h);
+        if (growthLeft == 0 && ctrl[i] == Empty) {
+            //reclaim the tombstones if they make up most of the load, grow otherwise
+            rehash(sz < maxLoad(cap) / 2 ? cap : 2 * cap);
+            i = findFree(h);
+        }
+        if (ctrl[i] == Empty) growthLeft --;
+        new (slots + i) Entry(key, value);
+        ctrl[i] = h2(h);
+        sz ++;
+    }
+
+    /**
+     * Removes the mapping for the specified key from this map if present.
+     * @throw ElementNotExist
+     */
+    void remove(const K &key) {
+        int i = find(key);
+        if (i == -1) throw ElementNotExist("\nNo Such Element.\n");
+        slots[i].~Entry();
+        //a group that still has an empty slot ends every probe, so nothing depends on
+        //this slot having been full
+        if (Group(ctrl + i / Width * Width).matchEmpty()) {ctrl[i] = Empty; growthLeft ++;}
+            else ctrl[i] = Deleted;
+        sz --;
+    }
+
+    /**
+     * Returns the allocator of this map.
+     */
+    A getAllocator() const {return alloc;}
+
+    /**
+     * Returns the number of key-value mappings in this map.
+     */
+    int size() const {return sz;}
+};
+
+#endif
@@ -0,0 +1,384 @@
+/** @file */
+#ifndef __FROZENHASHMAP_H
+#define __FROZENHASHMAP_H
+
+#include "ElementNotExist.h"
+#include "HashMap.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * FrozenHashMap is a read-only map stored in a file and used in place through a read-only
+ * memory mapping. freeze() compiles the contents of a HashMap into such a file once;
+ * opening it later maps the file without reading or rebuilding anything, so startup costs
+ * the same whatever the size of the table.
+ *
+ * The file holds the (key, value) pairs in one contiguous array, ordered by a perfect hash
+ * of their hash codes built by hash-and-displace: the hash code picks a bucket of about
+ * three codes, the bucket's displacement picks a slot, and every distinct hash code has a
+ * slot of its own. Buckets are placed largest first into a few more slots than codes, and
+ * buckets of a single code, which come last, take the free slots directly, so building
+ * takes expected linear time. A slot points to the pairs with that hash code, so a lookup
+ * is one hash, two array reads and normally a single key comparison. Keys whose hash
+ * codes collide share a slot and are compared one by one, so H needs no more than the
+ * HashMap contract.
+ *
+ * Only trivially copyable K and V can be stored, and the file is only readable on machines
+ * with the same type layout. A failing system call or a malformed file throws
+ * std::runtime_error: open() checks the header and the section sizes, and every lookup
+ * checks the slot and the offsets it reads, so that a corrupt table cannot send it outside
+ * the mapping, without open() having to read the whole table.
+ */
+template <class K, class V, class H>
+class FrozenHashMap
+{
+    static_assert(std::is_trivially_copyable<K>::value && std::is_trivially_copyable<V>::value, "FrozenHashMap needs trivially copyable keys and values");
+
+public:
+    struct Entry
+    {
+        K key;
+        V value;
+
+        const K &getKey() const
+        {
+            return key;
+        }
+
+        const V &getValue() const
+        {
+            return value;
+        }
+    };
+
+private:
+    struct Header{
+        char magic[8];
+        unsigned int keySize, valueSize, entrySize, seed;
+        unsigned int count, slots, buckets, version;
+    };
+    static const int HeaderSize = 64;
+    static const int BucketSize = 3;
+    static const unsigned int Version = 1;
+    //one slot in SpareSlots is left free, so the last buckets placed still find room
+    static const int SpareSlots = 32;
+    //a displacement with this bit set is the slot itself, for buckets of one code
+    static const unsigned int Direct = 1u << 31;
+    //a bucket gives up after this many times its expected number of tries
+    static const int TrySlack = 64;
+    static_assert(sizeof(Header) <= HeaderSize && alignof(Entry) <= HeaderSize, "entry alignment too large");
+
+    int fd;
+    size_t len;
+    char *base;
+    const Header *head;
+    const unsigned int *disp, *offset;
+    const Entry *entries;
+
+    static void fail(const char *what) {throw std::runtime_error(std::string("\nFrozenHashMap: ") + what + " failed\n");}
+
+    static unsigned long long fmix(unsigned long long x) {
+        x ^= x >> 33; x *= 0xff51afd7ed558ccdULL;
+        x ^= x >> 33; x *= 0xc4ceb9fe1a85ec53ULL;
+        x ^= x >> 33;
+        return x;
+    }
+    //maps the top bits of a mixed hash onto [0, n) without a division
+    static unsigned int reduce(unsigned long long h, unsigned int n) {return (unsigned int)((h >> 32) * n >> 32);}
+    static unsigned int bucketOf(unsigned int hc, unsigned int seed, unsigned int m) {
+        return reduce(fmix(hc ^ ((unsigned long long)seed << 32)), m);
+    }
+    static unsigned int slotOf(unsigned int hc, unsigned int d, unsigned int n) {
+        return reduce(fmix(hc + (d + 1ULL) * 0x9e3779b97f4a7c15ULL), n);
+    }
+    //the slot of hc once its bucket has the displacement d
+    static unsigned int slotFor(unsigned int hc, unsigned int d, unsigned int n) {
+        return d & Direct ? d & ~Direct : slotOf(hc, d, n);
+    }
+
+    //the byte offsets of the sections of a file holding count pairs
+    static size_t dispAt() {return HeaderSize;}
+    static size_t offsetAt(unsigned int buckets) {return dispAt() + sizeof(unsigned int) * buckets;}
+    static size_t entriesAt(unsigned int buckets, unsigned int slots) {
+        size_t p = offsetAt(buckets) + sizeof(unsigned int) * (slots + 1);
+        return (p + HeaderSize - 1) / HeaderSize * HeaderSize;
+    }
+    static size_t fileBytes(unsigned int buckets, unsigned int slots, unsigned int count) {
+        return entriesAt(buckets, slots) + sizeof(Entry) * count;
+    }
+
+    //finds a displacement for every bucket, largest buckets first, such that the slots of
+    //all distinct codes are different, and hands the slots left to the buckets of one code.
+    //Returns false if some bucket ran out of tries
+    static bool place(const std::vector<unsigned int> &codes, unsigned int seed, unsigned int m,
+            unsigned int slots, std::vector<unsigned int> &disp) {
+        unsigned int d = codes.size();
+        std::vector<unsigned int> start(m + 1, 0), member(d), order(m);
+        for (unsigned int j = 0; j < d; j ++) start[bucketOf(codes[j], seed, m) + 1] ++;
+        for (unsigned int b = 0; b < m; b ++) start[b + 1] += start[b];
+        std::vector<unsigned int> fill(start.begin(), start.end() - 1);
+        for (unsigned int j = 0; j < d; j ++) member[fill[bucketOf(codes[j], seed, m)] ++] = j;
+        for (unsigned int b = 0; b < m; b ++) order[b] = b;
+        std::stable_sort(order.begin(), order.end(), [&](unsigned int x, unsigned int y){
+            return start[x + 1] - start[x] > start[y + 1] - start[y];
+        });
+        //a bit per slot, so that the table stays in cache while the tries probe it
+        std::vector<unsigned long long> taken(slots / 64 + 1, 0);
+        std::vector<unsigned int> own(BucketSize * 16), pos(BucketSize * 16);
+        disp.assign(m, 0);
+        unsigned int i = 0, freeSlots = slots;
+        for (; i < m; i ++){
+            unsigned int b = order[i], k = start[b + 1] - start[b];
+            if (k <= 1) break;
+            if (pos.size() < k) {own.resize(k); pos.resize(k);}
+            for (unsigned int t = 0; t < k; t ++) own[t] = codes[member[start[b] + t]];
+            //a random displacement fits with probability about (free / slots)^k
+            double expect = std::pow((double)slots / freeSlots, (double)k);
+            if (expect * TrySlack >= Direct - TrySlack) return false;
+            unsigned int limit = (unsigned int)(expect * TrySlack) + TrySlack, q = 0;
+            for (;; q ++){
+                if (q == limit) return false;
+                bool ok = true;
+                for (unsigned int t = 0; t < k && ok; t ++){
+                    pos[t] = slotOf(own[t], q, slots);
+                    if (taken[pos[t] >> 6] >> (pos[t] & 63) & 1) ok = false;
+                    for (unsigned int u = 0; u < t && ok; u ++) if (pos[u] == pos[t]) ok = false;
+                }
+                if (ok) break;
+            }
+            disp[b] = q;
+            for (unsigned int t = 0; t < k; t ++) taken[pos[t] >> 6] |= 1ULL << (pos[t] & 63);
+            freeSlots -= k;
+        }
+        for (unsigned int f = 0; i < m && start[order[i] + 1] > start[order[i]]; i ++, f ++){
+            while (taken[f >> 6] >> (f & 63) & 1) f ++;
+            disp[order[i]] = Direct | f;
+        }
+        return true;
+    }
+
+    static void writeAll(int out, const void *p, size_t n) {
+        const char *c = static_cast<const char *>(p);
+        while (n > 0){
+            ssize_t w = ::write(out, c, n);
+            if (w < 0) fail("write");
+            c += w; n -= w;
+        }
+    }
+
+    void unmap() {
+        if (base != NULL) munmap(base, len);
+        base = NULL; head = NULL; disp = offset = NULL; entries = NULL;
+    }
+
+    FrozenHashMap(const FrozenHashMap &);
+    FrozenHashMap &operator=(const FrozenHashMap &);
+public:
+    class Iterator
+    {
+        const FrozenHashMap *map;
+        int pos;
+    public:
+        void init(const FrozenHashMap *_m){map = _m; pos = 0;}
+        /**
+         * Returns true if the iteration has more elements.
+         */
+        bool hasNext() {return pos < map->size();}
+
+        /**
+         * Returns the next element in the iteration.
+         * @throw ElementNotExist exception when hasNext() == false
+         */
+        const Entry &next() {
+            if (!hasNext()) throw ElementNotExist("\nNo Such Element.\n");
+            return map->entries[pos ++];
+        }
+    };
+
+    /**
+     * Writes the contents of map to a new frozen map file at path. The file is written
+     * next to path and renamed over it at the end, so processes that have the old file
+     * mapped keep reading the old contents.
+     */
+    template <class A>
+    static void freeze(const HashMap<K, V, H, A> &map, const char *path) {
+        unsigned int n = map.size();
+        std::vector<Entry> pairs;
+        pairs.reserve(n);
+        std::vector<unsigned int> hc;
+        hc.reserve(n);
+        typename HashMap<K, V, H, A>::Iterator it = map.iterator();
+        while (it.hasNext()){
+            const typename HashMap<K, V, H, A>::Entry &e = it.next();
+            Entry x;
+            x.key = e.getKey(); x.value = e.getValue();
+            pairs.push_back(x);
+            hc.push_back(H::hashCode(e.getKey()));
+        }
+
+        //the distinct hash codes get the slots
+        std::vector<unsigned int> codes(hc);
+        std::sort(codes.begin(), codes.end());
+        codes.erase(std::unique(codes.begin(), codes.end()), codes.end());
+        unsigned int d = codes.size(), m = (d + BucketSize - 1) / BucketSize;
+        if (m == 0) m = 1;
+        unsigned int slots = d + d / SpareSlots;
+        std::vector<unsigned int> disp;
+        unsigned int seed = 0;
+        while (!place(codes, seed, m, slots, disp)) seed ++;
+
+        //pairs are stored grouped by slot, offset[s] is where the group of slot s starts
+        std::vector<unsigned int> offset(slots + 1, 0), where(n);
+        for (unsigned int i = 0; i < n; i ++){
+            where[i] = slotFor(hc[i], disp[bucketOf(hc[i], seed, m)], slots);
+            offset[where[i] + 1] ++;
+        }
+        for (unsigned int s = 0; s < slots; s ++) offset[s + 1] += offset[s];
+        std::vector<Entry> sorted(n);
+        std::vector<unsigned int> fill(offset.begin(), offset.end() - 1);
+        for (unsigned int i = 0; i < n; i ++) sorted[fill[where[i]] ++] = pairs[i];
+
+        char header[HeaderSize];
+        std::memset(header, 0, sizeof(header));
+        Header *h = reinterpret_cast<Header *>(header);
+        std::memcpy(h->magic, "DSFROZHM", 8);
+        h->keySize = sizeof(K); h->valueSize = sizeof(V); h->entrySize = sizeof(Entry);
+        h->seed = seed; h->count = n; h->slots = slots; h->buckets = m; h->version = Version;
+
+        std::string tmp = std::string(path) + ".tmp";
+        int out = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (out < 0) fail("open");
+        try {
+            writeAll(out, header, HeaderSize);
+            writeAll(out, disp.data(), sizeof(unsigned int) * m);
+            writeAll(out, offset.data(), sizeof(unsigned int) * (slots + 1));
+            char pad[HeaderSize] = {0};
+            writeAll(out, pad, entriesAt(m, slots) - offsetAt(m) - sizeof(unsigned int) * (slots + 1));
+            if (n > 0) writeAll(out, sorted.data(), sizeof(Entry) * n);
+            if (::fsync(out) != 0) fail("fsync");
+        } catch (...) {
+            ::close(out);
+            ::unlink(tmp.c_str());
+            throw;
+        }
+        ::close(out);
+        if (std::rename(tmp.c_str(), path) != 0) {::unlink(tmp.c_str()); fail("rename");}
+    }
+
+    /**
+     * Constructs a map with no file behind it, open() has to be called before use.
+     */
+    FrozenHashMap() {fd = -1; len = 0; base = NULL; head = NULL; disp = offset = NULL; entries = NULL;}
+
+    /**
+     * Constructs a map backed by the frozen map file at path, see open().
+     */
+    explicit FrozenHashMap(const char *path) {
+        fd = -1; len = 0; base = NULL; head = NULL; disp = offset = NULL; entries = NULL;
+        open(path);
+    }
+
+    /**
+     * Destructor, unmaps the file.
+     */
+    ~FrozenHashMap() {close();}
+
+    /**
+     * Maps the frozen map file at path, written by freeze(). Nothing but the header is read.
+     * @throw std::runtime_error if the file cannot be mapped or its header is malformed
+     */
+    void open(const char *path) {
+        close();
+        fd = ::open(path, O_RDONLY);
+        if (fd < 0) fail("open");
+        struct stat st;
+        if (fstat(fd, &st) != 0) {close(); fail("fstat");}
+        if (st.st_size < HeaderSize) {close(); fail("header check");}
+        void *p = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED) {close(); fail("mmap");}
+        base = static_cast<char *>(p); len = st.st_size;
+        head = reinterpret_cast<const Header *>(base);
+        if (std::memcmp(head->magic, "DSFROZHM", 8) != 0 || head->keySize != sizeof(K) || head->valueSize != sizeof(V)
+                || head->entrySize != sizeof(Entry) || head->version != Version
+                || head->buckets == 0 || head->slots > head->count + head->count / SpareSlots || head->slots >= Direct
+                || fileBytes(head->buckets, head->slots, head->count) != len)
+            {close(); fail("header check");}
+        disp = reinterpret_cast<const unsigned int *>(base + dispAt());
+        offset = reinterpret_cast<const unsigned int *>(base + offsetAt(head->buckets));
+        entries = reinterpret_cast<const Entry *>(base + entriesAt(head->buckets, head->slots));
+    }
+
+    /**
+     * Unmaps and closes the file, if one is open.
+     */
+    void close() {
+        unmap();
+        if (fd >= 0) ::close(fd);
+        fd = -1;
+    }
+
+    /**
+     * Returns true if a file is mapped.
+     */
+    bool isOpen() const {return base != NULL;}
+
+    /**
+     * Returns a pointer to the pair holding the specified key, or NULL if there is none.
+     * @throw std::runtime_error if the part of the table the key leads to is corrupt
+     */
+    const Entry *find(const K &key) const {
+        if (base == NULL || head->slots == 0) return NULL;
+        unsigned int hc = H::hashCode(key);
+        unsigned int s = slotFor(hc, disp[bucketOf(hc, head->seed, head->buckets)], head->slots);
+        if (s >= head->slots || offset[s] > offset[s + 1] || offset[s + 1] > head->count) fail("table check");
+        for (unsigned int i = offset[s]; i < offset[s + 1]; i ++)
+            if (entries[i].getKey() == key) return entries + i;
+        return NULL;
+    }
+
+    /**
+     * Returns true if this map contains a mapping for the specified key.
+     */
+    bool containsKey(const K &key) const {return find(key) != NULL;}
+
+    /**
+     * Returns a const reference to the value to which the specified key is mapped.
+     * @throw ElementNotExist
+     */
+    const V &get(const K &key) const {
+        const Entry *e = find(key);
+        if (e == NULL) throw ElementNotExist("\nNo Such Element.\n");
+        return e->getValue();
+    }
+
+    /**
+     * Returns true if this map contains no key-value mappings.
+     */
+    bool isEmpty() const {return size() == 0;}
+
+    /**
+     * Returns the number of key-value mappings in this map.
+     */
+    int size() const {return base == NULL ? 0 : head->count;}
+
+    /**
+     * Returns an iterator over the elements in this map.
+     */
+    Iterator iterator() const {
+        Iterator iter;
+        iter.init(this);
+        return iter;
+    }
+};
+
+#endif
@@ -0,0 +1,246 @@
+/** @file */
+#ifndef __HASHFUNCTIONS_H
+#define __HASHFUNCTIONS_H
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <utility>
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
+#ifdef __SSE4_2__
+#include <nmmintrin.h>
+#endif
+
+/**
+ * Ready-made hash functions for the H parameter of HashMap, FlatHashMap and
+ * ConcurrentHashMap, for example
+ * @code
+ *      HashMap<long long, int, IntHash> ids;
+ *      HashMap<std::string, int, StringHash> words;
+ * @endcode
+ *
+ * Besides the usual static hashCode returning int, each of them has a static hash64
+ * returning the full 64-bit hash. The maps use hash64 when H has one, see WideHash, and
+ * skip their own mixing then, since these hashes are well mixed already; hashCode folds
+ * hash64 to 32 bits for everything else.
+ *
+ * StringHash and Crc32cHash are transparent: std::string keys can be looked up by a
+ * const char *, or from C++17 on by a std::string_view, without building a temporary
+ * string. From C++17 on they are also callable on a std::string_view, so they serve as
+ * the hash of a std::unordered_map with std::string keys too.
+ */
+
+/**
+ * The 64-bit murmur3 finalizer. Every bit of x affects every bit of the result.
+ */
+inline unsigned long long mix64(unsigned long long x) {
+    x ^= x >> 33; x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33; x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+/**
+ * True if H has a hash64 taking a Q.
+ */
+template <class H, class Q, class = void>
+struct WideHash: std::false_type {};
+template <class H, class Q>
+struct WideHash<H, Q, decltype((void)H::hash64(std::declval<const Q &>()))>: std::true_type {};
+
+template <class H, class Q>
+inline unsigned long long hashOf(const Q &key, std::true_type) {return H::hash64(key);}
+template <class H, class Q>
+inline unsigned long long hashOf(const Q &key, std::false_type) {return mix64((unsigned int)H::hashCode(key));}
+
+/**
+ * Returns the 64-bit hash of key: H::hash64(key) if there is one, otherwise
+ * H::hashCode(key) run through mix64().
+ */
+template <class H, class Q>
+inline unsigned long long hashOf(const Q &key) {return hashOf<H>(key, WideHash<H, Q>());}
+
+/**
+ * Hashes integers of any width, and enums, with the splitmix64 finalizer, a handful of
+ * multiplies and shifts. Unlike the identity, it spreads keys that differ only in their
+ * high bits, or that are all multiples of a power of two, over the whole table.
+ */
+struct IntHash
+{
+    template <class T>
+    static typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value, unsigned long long>::type
+    hash64(T key) {
+        unsigned long long x = (unsigned long long)key;
+        x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ULL;
+        x ^= x >> 27; x *= 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+    template <class T>
+    static int hashCode(T key) {
+        unsigned long long x = hash64(key);
+        return (int)(x ^ (x >> 32));
+    }
+};
+
+/**
+ * Hashes strings and integers with CRC32C, using the crc32 instruction of SSE4.2 when the
+ * code is compiled for it (-msse4.2) and a table otherwise; both give the same codes. The
+ * CRC only has 32 bits, so hash64 spreads them with mix64() and carries no more than that.
+ * Strings are hashed 8 bytes per instruction, which makes it the fastest choice on x86 for
+ * short and medium keys, but a CRC is linear and easy to collide on purpose; use
+ * StringHash for keys an attacker chooses.
+ */
+struct Crc32cHash
+{
+    typedef void is_transparent;
+
+    /**
+     * Returns the CRC32C of n bytes at p, continuing from crc.
+     */
+    static unsigned int crc(const void *p, size_t n, unsigned int crc = 0) {
+        const unsigned char *s = static_cast<const unsigned char *>(p);
+        crc = ~crc;
+#ifdef __SSE4_2__
+#ifdef __x86_64__
+        for (; n >= 8; n -= 8, s += 8){
+            unsigned long long w;
+            std::memcpy(&w, s, 8);
+            crc = (unsigned int)_mm_crc32_u64(crc, w);
+        }
+#endif
+        for (; n > 0; n --, s ++) crc = _mm_crc32_u8(crc, *s);
+#else
+        const unsigned int *t = table();
+        for (; n > 0; n --, s ++) crc = t[(crc ^ *s) & 0xFF] ^ (crc >> 8);
+#endif
+        return ~crc;
+    }
+
+    static unsigned long long hash64(const std::string &key) {return mix64(crc(key.data(), key.size()));}
+    static unsigned long long hash64(const char *key) {return mix64(crc(key, std::strlen(key)));}
+#if __cplusplus >= 201703L
+    static unsigned long long hash64(std::string_view key) {return mix64(crc(key.data(), key.size()));}
+    size_t operator()(std::string_view key) const {return (size_t)hash64(key);}
+#endif
+    template <class T>
+    static typename std::enable_if<std::is_integral<T>::value, unsigned long long>::type hash64(T key) {
+        unsigned long long w = (unsigned long long)key;
+        return mix64(crc(&w, sizeof(w)));
+    }
+    template <class T>
+    static int hashCode(const T &key) {
+        unsigned long long x = hash64(key);
+        return (int)(x ^ (x >> 32));
+    }
+
+private:
+    //the byte-at-a-time table of the reflected polynomial 0x82F63B78
+    struct Table
+    {
+        unsigned int v[256];
+        Table() {
+            for (unsigned int i = 0; i < 256; i ++){
+                unsigned int c = i;
+                for (int k = 0; k < 8; k ++) c = c & 1 ? (c >> 1) ^ 0x82F63B78u : c >> 1;
+                v[i] = c;
+            }
+        }
+    };
+    static const unsigned int *table() {
+        static const Table t;
+        return t.v;
+    }
+};
+
+/**
+ * Hashes strings in the style of wyhash: 8-byte words are combined pairwise by a full
+ * 64x64->128-bit multiply, and long strings are consumed 48 bytes per round in three
+ * independent lanes so their multiplies overlap. Keys up to 16 bytes take two multiplies
+ * in total. Unlike a CRC or a byte-at-a-time loop it is not linear in the key, so colliding
+ * keys are hard to construct; hash() takes a seed for callers that want it secret, while
+ * the maps use seed 0.
+ */
+struct StringHash
+{
+    typedef void is_transparent;
+
+    /**
+     * Returns the hash of n bytes at p under seed.
+     */
+    static unsigned long long hash(const void *p, size_t n, unsigned long long seed = 0) {
+        const unsigned char *s = static_cast<const unsigned char *>(p);
+        unsigned long long a, b;
+        seed ^= mum(seed ^ S0, S1);
+        if (n <= 16){
+            if (n >= 4){
+                size_t d = (n >> 3) << 2;
+                a = (r4(s) << 32) | r4(s + d);
+                b = (r4(s + n - 4) << 32) | r4(s + n - 4 - d);
+            }else if (n > 0){
+                a = ((unsigned long long)s[0] << 16) | ((unsigned long long)s[n >> 1] << 8) | s[n - 1];
+                b = 0;
+            }else a = b = 0;
+        }else{
+            size_t i = n;
+            if (i > 48){
+                unsigned long long l1 = seed, l2 = seed;
+                do{
+                    seed = mum(r8(s) ^ S1, r8(s + 8) ^ seed);
+                    l1 = mum(r8(s + 16) ^ S2, r8(s + 24) ^ l1);
+                    l2 = mum(r8(s + 32) ^ S3, r8(s + 40) ^ l2);
+                    s += 48; i -= 48;
+                }while (i > 48);
+                seed ^= l1 ^ l2;
+            }
+            for (; i > 16; i -= 16, s += 16) seed = mum(r8(s) ^ S1, r8(s + 8) ^ seed);
+            a = r8(s + i - 16); b = r8(s + i - 8);
+        }
+        mul(a ^ S1, b ^ seed, a, b);
+        return mum(a ^ S0 ^ n, b ^ S1);
+    }
+
+    static unsigned long long hash64(const std::string &key) {return hash(key.data(), key.size());}
+    static unsigned long long hash64(const char *key) {return hash(key, std::strlen(key));}
+#if __cplusplus >= 201703L
+    static unsigned long long hash64(std::string_view key) {return hash(key.data(), key.size());}
+    size_t operator()(std::string_view key) const {return (size_t)hash64(key);}
+#endif
+    template <class T>
+    static int hashCode(const T &key) {
+        unsigned long long x = hash64(key);
+        return (int)(x ^ (x >> 32));
+    }
+
+private:
+    static const unsigned long long S0 = 0xa0761d6478bd642fULL, S1 = 0xe7037ed1a0b428dbULL;
+    static const unsigned long long S2 = 0x8ebc6af09c88c6e3ULL, S3 = 0x589965cc75374cc3ULL;
+
+    static unsigned long long r8(const unsigned char *p) {unsigned long long v; std::memcpy(&v, p, 8); return v;}
+    static unsigned long long r4(const unsigned char *p) {unsigned int v; std::memcpy(&v, p, 4); return v;}
+
+    //the full product of x and y, low half in lo and high half in hi
+    static void mul(unsigned long long x, unsigned long long y, unsigned long long &lo, unsigned long long &hi) {
+#ifdef __SIZEOF_INT128__
+        __extension__ typedef unsigned __int128 Wide;
+        Wide r = (Wide)x * y;
+        lo = (unsigned long long)r; hi = (unsigned long long)(r >> 64);
+#else
+        unsigned long long xl = x & 0xFFFFFFFFu, xh = x >> 32, yl = y & 0xFFFFFFFFu, yh = y >> 32;
+        unsigned long long ll = xl * yl, lh = xl * yh, hl = xh * yl, hh = xh * yh;
+        unsigned long long mid = (ll >> 32) + (lh & 0xFFFFFFFFu) + (hl & 0xFFFFFFFFu);
+        lo = (mid << 32) | (ll & 0xFFFFFFFFu);
+        hi = hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+#endif
+    }
+    //the two halves of the product folded together
+    static unsigned long long mum(unsigned long long x, unsigned long long y) {
+        unsigned long long lo, hi;
+        mul(x, y, lo, hi);
+        return lo ^ hi;
+    }
+};
+
+#endif
@@ -4,6 +4,18 @@
 #define __HASHMAP_H
 
 #include "ElementNotExist.h"
+#include "Allocator.h"
+#include "BloomFilter.h"
+#include "HashFunctions.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <iterator>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
 
 
 /**
@@ -28,6 +40,14 @@
  *      HashMap<int, int, Hashint> hash;
  * @endcode
  *
+ * If H also declares a type is_transparent and hashCode overloads for other types, such as
+ * const char * next to std::string, the lookup functions accept those types directly,
+ * without building a temporary K. Each overload must hash a value the same way as the key
+ * equal to it, and K == Q must be defined.
+ *
+ * If H also has a static hash64 returning a 64-bit hash, as the functions in
+ * HashFunctions.h do, the map uses it, folded to 32 bits, instead of hashCode.
+ *
  * Hash function passed to this class should observe the following rule: if two keys
  * are equal (which means key1 == key2), then the hash code of them should be the
  * same. However, it is not generally required that the hash function should work in
@@ -39,10 +59,64 @@
  * for all keys (thus causing a serious collision), methods of HashMap should still
  * function correctly, though the performance will be poor in this case.
  *
+ * The hash code is run through a mixing function and the capacity is always a power of
+ * two, so a bucket is picked by masking the mixed hash. Every node keeps its mixed hash:
+ * chain walks compare it before the keys, and resizing never calls hashCode again.
+ *
+ * A bucket whose chain reaches TreeifyAt nodes also gets a treap over its nodes, ordered by
+ * hash and then by operator< on the keys as in TreeMap, so even a hash function that maps
+ * every key to the same code, by accident or chosen by an attacker, only costs O(log n)
+ * per lookup. The chain itself is kept, in tree order, and the treap is dropped again once
+ * the chain is down to UntreeifyAt nodes. Keys without operator< are never treeified, and
+ * lookups by a key of another type walk the chain. operator< needs to be a strict weak
+ * order but need not agree with operator==: below a node whose key it ties with the key
+ * looked up, both subtrees are searched, so only keys that < cannot tell apart cost a
+ * linear search among themselves.
+ *
  * The order of iteration could be arbitary in HashMap. But it should be guaranteed
  * that each (key, value) pair be iterated exactly once.
+ *
+ * Nodes and bucket arrays are allocated from the allocator A, see Allocator.h.
+ *
+ * stats() reports the shape of the table, which shows a poor hash function as long chains,
+ * few distinct hash codes and a mean probe length far above 1 + load factor / 2. With
+ * setProbeCounting(true) the map also records how many nodes every single-key lookup,
+ * get() and put() included, had to compare. The counters are relaxed atomics, so const
+ * lookups may still run on several threads at once while they are on.
+ *
+ * A new map allocates nothing. Up to SmallMax entries are kept in a single chain whose
+ * head lives in the map object itself, searched linearly; the bucket array, D_cap buckets
+ * at first, is only allocated when the map outgrows that. Everything else, the load
+ * factor, the state of an incremental resize, the rehash counters, the treaps, the bloom
+ * filter and the probe counters, lives in a side block that is only allocated once the
+ * map first grows or one of them leaves its default, so an empty map is just a bucket
+ * pointer, the capacity, the size and the inline bucket.
+ *
+ * setBloomFilter() adds a BloomFilter over the mixed hashes of the keys, which every
+ * lookup consults first, so that looking up a missing key mostly costs one cache line
+ * instead of a bucket and a chain walk. A present key pays for that line on top, so the
+ * filter only pays off when most lookups miss. Removed keys stay in the filter until it is
+ * rebuilt from the map, which happens whenever more hashes were added to it than it is
+ * sized for; the filter also grows then, to twice the size of the map.
+ *
+ * The map grows once its size passes capacity times the load factor, 0.75 unless given
+ * otherwise. When the number of entries is known up front, HashMap(expectedSize),
+ * reserve(), or putAll() and multiPut() into an empty map, size the table once so that
+ * loading it never rehashes.
+ *
+ * By default the map grows in one go inside the put() that fills it. With
+ * setIncrementalRehash(true) it keeps the old bucket array next to the new one instead,
+ * and every put or remove moves a few more buckets over, so no single call pays for the
+ * whole resize. Lookups check both arrays while a resize is in progress.
+ *
+ * Two O(capacity) steps remain in the put() that starts a resize: the new bucket array is
+ * allocated and zero-filled at once, a memset of 8 bytes per bucket, which is far cheaper
+ * than relinking the nodes but not free on huge tables. And a resize that starts while the
+ * previous one is still draining finishes that one first. put() and remove() move
+ * MigrateStep buckets each, so a drain is always done long before the next doubling; only
+ * reserve(), putAll() and multiPut(), which finish the drain on purpose, pay for it at once.
  */
-template <class K, class V, class H>
+template <class K, class V, class H, class A = HeapAllocator>
 class HashMap
 {
 public:
@@ -52,11 +126,7 @@ public:
         V value;
     public:
         Entry(){}
-        Entry(K k, V v)
-        {
-            key = k;
-            value = v;
-        }
+        Entry(const K &k, const V &v): key(k), value(v) {}
         Entry(const Entry &x){
             key = x.key; value = x.value; 
         }
@@ -66,12 +136,12 @@ public:
             return *this;
         }
 
-        K getKey() const
+        const K &getKey() const
         {
             return key;
         }
 
-        V getValue() const
+        const V &getValue() const
         {
             return value;
         }
@@ -86,55 +156,574 @@ public:
     public:
         Entry data;
         Node *nxt;
+        unsigned int hash;
         Node(){}
-        Node(Entry _d, Node *_n = NULL):data(_d), nxt(_n){}
+        Node(const Entry &_d, Node *_n = NULL, unsigned int _h = 0):data(_d), nxt(_n), hash(_h){}
     };
-    const static int D_cap = 11;
-    const static double Factor = 0.75;
+    /**
+     * The shape of the table and the counters of a map, see stats().
+     */
+    struct Stats
+    {
+        const static int Histogram = 9;
+        int buckets, size, distinctHashes, maxChain;
+        //the buckets that have a treap over their chain
+        int treeBuckets;
+        double loadFactor, emptyRatio;
+        //the mean number of nodes compared by a lookup of a present key, counting the whole
+        //chain in front of it even in a treeified bucket
+        double meanProbe;
+        //chainHistogram[i] buckets hold i nodes, the last bin i or more
+        long long chainHistogram[Histogram];
+        long long rehashes;
+        double rehashSeconds;
+        //only counted in probe counting mode: the lookups made, the nodes they compared in
+        //total and at most, and probeHistogram[i] lookups compared i nodes
+        long long lookups, probes;
+        int maxProbe;
+        long long probeHistogram[Histogram];
+    };
+    const static int D_cap = 16;
+    const static int SmallMax = 4;
+    const static int MaxCap = 1 << 30;
+    const static int MigrateStep = 8;
+    const static int Batch = 16;
+    const static int TreeifyAt = 8;
+    const static int UntreeifyAt = 6;
     int cap, thereshold;
     Node** buckets;
     int sz;
+    A alloc;
+    //the only bucket of a map with capacity 1, see the class documentation
+    Node *small;
 
-    int hash(const K &key) const{
-        int res = (H::hashCode(key) % cap + cap) % cap;
-       // std::cout<<H::hashCode(key)<std::endl;
-        return res;
+    //the probe counters, written by const lookups and so atomic
+    struct ProbeCounts
+    {
+        std::atomic<long long> lookups, probes, hist[Stats::Histogram];
+        std::atomic<int> maxProbe;
+    };
+    //a node of the treap over the chain of a treeified bucket
+    struct TreeNode
+    {
+        Node *node;
+        TreeNode *l, *r;
+    };
+    //the state only a map that has grown, treeified a bucket or changed a setting needs
+    struct Extra
+    {
+        double factor;
+        //the bucket array drained by an incremental resize, its buckets below migrated are empty
+        Node** oldBuckets;
+        int oldCap, migrated;
+        bool incremental;
+        long long rehashes;
+        double rehashSeconds;
+        //per bucket roots of the treaps of buckets and oldBuckets, NULL until a bucket is treeified
+        TreeNode **trees, **oldTrees;
+        //NULL unless a bloom filter is set
+        BloomFilter<A> *bloom;
+        //NULL unless probe counting is on
+        ProbeCounts *counts;
+
+        constexpr Extra(): factor(0.75), oldBuckets(NULL), oldCap(0), migrated(0), incremental(false),
+            rehashes(0), rehashSeconds(0), trees(NULL), oldTrees(NULL), bloom(NULL), counts(NULL) {}
+    };
+    //NULL as long as everything in it has its default
+    Extra *extra;
+
+    //the side block for reading, a shared one holding the defaults while there is none
+    const Extra &ext() const {
+        static const Extra none;
+        return extra != NULL ? *extra : none;
+    }
+    //the side block for writing, allocated on first use
+    Extra &more() {
+        if (extra == NULL) extra = new (alloc.allocate(sizeof(Extra))) Extra();
+        return *extra;
     }
+    void deleteExtra() {
+        if (extra == NULL) return;
+        alloc.deallocate(extra, sizeof(Extra));
+        extra = NULL;
+    }
+    void setFactor(double f) {if (f != ext().factor) more().factor = f;}
 
-    void rehash(){
-        Node** tmp = buckets;
-        int l_cap = cap;
-        cap *= 2;
-        buckets = new Node* [cap];
-        thereshold = cap * Factor;
-        for (int i = 0; i < cap; i ++) buckets[i] = NULL; 
-        for (int i = 0; i < l_cap; i ++){
-            Node *e = tmp[i];
-            for (;e != NULL; e = e->nxt){
-                int idx = hash(e->data.getKey());
-                Node *cur = new Node(e->data, buckets[idx]);
-                buckets[idx] = cur;
+    template <class T, class = void>
+    struct Ordered: std::false_type {};
+    template <class T>
+    struct Ordered<T, decltype((void)(std::declval<const T &>() < std::declval<const T &>()))>: std::true_type {};
+
+    Node *newNode(const Entry &d, Node *n, unsigned int h) {
+        void *p = alloc.allocate(sizeof(Node));
+        return new (p) Node(d, n, h);
+    }
+    void deleteNode(Node *p) {
+        p->~Node();
+        alloc.deallocate(p, sizeof(Node));
+    }
+    Node **newBuckets(int n) {
+        Node **b = static_cast<Node **>(alloc.allocate(sizeof(Node *) * n));
+        for (int i = 0; i < n; i ++) b[i] = NULL;
+        return b;
+    }
+    void deleteBuckets(Node **b, int n) {if (b != &small) alloc.deallocate(b, sizeof(Node *) * n);}
+    //the bucket array of capacity c, which is the inline bucket for c == 1
+    Node **bucketsFor(int c) {
+        if (c > 1) return newBuckets(c);
+        small = NULL;
+        return &small;
+    }
+    //the number of entries a table of capacity c holds before it grows
+    int limit(int c) const {return c == 1 ? SmallMax : c * ext().factor;}
+    TreeNode *newTreeNode(Node *e) {
+        TreeNode *t = static_cast<TreeNode *>(alloc.allocate(sizeof(TreeNode)));
+        t->node = e; t->l = t->r = NULL;
+        return t;
+    }
+    void deleteTree(TreeNode *t) {
+        if (t == NULL) return;
+        deleteTree(t->l); deleteTree(t->r);
+        alloc.deallocate(t, sizeof(TreeNode));
+    }
+    TreeNode **newTrees(int n) {
+        TreeNode **t = static_cast<TreeNode **>(alloc.allocate(sizeof(TreeNode *) * n));
+        for (int i = 0; i < n; i ++) t[i] = NULL;
+        return t;
+    }
+    //frees the treaps of buckets [from, n) of t and the array itself
+    void deleteTrees(TreeNode **t, int from, int n) {
+        if (t == NULL) return;
+        if (!A::noopDeallocate)
+            for (int i = from; i < n; i ++) deleteTree(t[i]);
+        alloc.deallocate(t, sizeof(TreeNode *) * n);
+    }
+
+    //frees the nodes in buckets [from, n) of b and the array itself, skipping the node walk
+    //when the allocator frees nothing and the entries need no destructor
+    void deleteTable(Node **b, int from, int n) {
+        if (!A::noopDeallocate || !std::is_trivially_destructible<Entry>::value)
+            for (int i = from; i < n; i ++){
+                Node *e = b[i];
+                while (e != NULL){
+                    Node *tmp = e->nxt;
+                    deleteNode(e); e = tmp;
+                }
             }
+        deleteBuckets(b, n);
+    }
+
+    //frees every node and the bucket arrays
+    void deleteAll() {
+        deleteTable(buckets, 0, cap);
+        if (extra == NULL) return;
+        Extra &x = *extra;
+        deleteTrees(x.trees, 0, cap);
+        if (x.oldBuckets != NULL) {deleteTable(x.oldBuckets, x.migrated, x.oldCap); deleteTrees(x.oldTrees, x.migrated, x.oldCap);}
+        x.oldBuckets = NULL; x.oldCap = x.migrated = 0;
+        x.trees = x.oldTrees = NULL;
+    }
+
+    //copies the chains of x, which has the same capacity, into a map without buckets or
+    //treaps. A resize in progress in x is finished in the copy
+    void copyBuckets(const HashMap &x) {
+        buckets = bucketsFor(cap);
+        for (int i = 0; i < cap; i ++){
+            for (Node *e = x.buckets[i]; e != NULL; e = e->nxt)
+                link(newNode(e->data, NULL, e->hash));
+        }
+        const Extra &o = x.ext();
+        if (o.oldBuckets != NULL)
+            for (int i = o.migrated; i < o.oldCap; i ++)
+                for (Node *e = o.oldBuckets[i]; e != NULL; e = e->nxt)
+                    link(newNode(e->data, NULL, e->hash));
+    }
+
+    //only valid when H hashes Q like K, see the class documentation
+    template <class Q, class HH>
+    using Probe = typename std::enable_if<!std::is_same<Q, K>::value, typename HH::is_transparent>::type;
+
+    //the order of the treaps: by hash, then by key. K only has to provide ==, so < may tie
+    //keys that are not equal; such keys can end up on either side of each other
+    static bool keyLess(const K &a, const K &b, std::true_type) {return a < b;}
+    static bool keyLess(const K &, const K &, std::false_type) {return false;}
+    static bool before(unsigned int h, const K &key, const Node *e) {
+        return h < e->hash || (h == e->hash && keyLess(key, e->data.getKey(), Ordered<K>()));
+    }
+    //true if e, which is in the treap below t but is not t itself, is in its left subtree
+    static bool leftOf(const TreeNode *t, const Node *e) {
+        if (before(e->hash, e->data.getKey(), t->node)) return true;
+        if (before(t->node->hash, t->node->data.getKey(), e)) return false;
+        return holds(t->l, e);
+    }
+    //true if e is in the treap t
+    static bool holds(const TreeNode *t, const Node *e) {
+        while (t != NULL && t->node != e) t = leftOf(t, e) ? t->l : t->r;
+        return t != NULL;
+    }
+    //treap priorities, drawn from the addresses of the tree nodes so keys cannot steer them
+    static unsigned long long priority(const TreeNode *t) {
+        unsigned long long x = (unsigned long long)(size_t)t;
+        x ^= x >> 33; x *= 0xff51afd7ed558ccdULL;
+        x ^= x >> 33; x *= 0xc4ceb9fe1a85ec53ULL;
+        return x ^ (x >> 33);
+    }
+    static void rotL(TreeNode *&t) {
+        TreeNode *y = t->r;
+        t->r = y->l; y->l = t; t = y;
+    }
+    static void rotR(TreeNode *&t) {
+        TreeNode *y = t->l;
+        t->l = y->r; y->r = t; t = y;
+    }
+
+    //adds e to the treap t, setting pred to the node before it in tree order, or NULL
+    void treeInsert(TreeNode *&t, Node *e, Node *&pred) {
+        if (t == NULL) {t = newTreeNode(e); return;}
+        if (before(e->hash, e->data.getKey(), t->node)){
+            treeInsert(t->l, e, pred);
+            if (priority(t->l) > priority(t)) rotR(t);
+        }else{
+            pred = t->node;
+            treeInsert(t->r, e, pred);
+            if (priority(t->r) > priority(t)) rotL(t);
+        }
+    }
+    //takes e out of the treap t, rotating it down until it has at most one child
+    void treeErase(TreeNode *&t, Node *e) {
+        if (t->node != e) {treeErase(leftOf(t, e) ? t->l : t->r, e); return;}
+        if (t->l == NULL || t->r == NULL){
+            TreeNode *x = t;
+            t = t->l != NULL ? t->l : t->r;
+            alloc.deallocate(x, sizeof(TreeNode));
+        }else if (priority(t->l) > priority(t->r)) {rotR(t); treeErase(t->r, e);}
+            else {rotL(t); treeErase(t->l, e);}
+    }
+    //the node before e, which is in the treap t, in tree order and so in its chain
+    static Node *treePred(const TreeNode *t, const Node *e) {
+        Node *p = NULL;
+        while (t->node != e)
+            if (leftOf(t, e)) t = t->l;
+                else {p = t->node; t = t->r;}
+        if (t->l != NULL){
+            for (t = t->l; t->r != NULL; t = t->r);
+            p = t->node;
+        }
+        return p;
+    }
+    //looks key up in the treap t, counting the nodes compared in n. Keys of another type
+    //than K are not ordered against K, so for them it returns false and the chain is walked
+    bool treeFind(const TreeNode *t, const K &key, unsigned int h, Node *&res, int &n) const {
+        res = treeSearch(t, key, h, n);
+        return true;
+    }
+    //below a node whose key ties with key under < without being equal, key may be on
+    //either side, so both subtrees are searched there
+    static Node *treeSearch(const TreeNode *t, const K &key, unsigned int h, int &n) {
+        while (t != NULL){
+            n ++;
+            Node *e = t->node;
+            if (e->hash == h && e->data.getKey() == key) return e;
+            if (before(h, key, e)) t = t->l;
+                else if (e->hash < h || keyLess(e->data.getKey(), key, Ordered<K>())) t = t->r;
+                else{
+                    Node *r = treeSearch(t->r, key, h, n);
+                    if (r != NULL) return r;
+                    t = t->l;
+                }
+        }
+        return NULL;
+    }
+    template <class Q>
+    bool treeFind(const TreeNode *, const Q &, unsigned int, Node *&, int &) const {return false;}
+
+    //links e into the chain of its bucket, treeifying the bucket once the chain is long enough
+    void link(Node *e) {
+        int idx = index(e->hash, cap);
+        TreeNode **trees = ext().trees;
+        if (trees != NULL && trees[idx] != NULL){
+            Node *pred = NULL;
+            treeInsert(trees[idx], e, pred);
+            if (pred == NULL) {e->nxt = buckets[idx]; buckets[idx] = e;}
+                else {e->nxt = pred->nxt; pred->nxt = e;}
+            return;
+        }
+        e->nxt = buckets[idx]; buckets[idx] = e;
+        if (!Ordered<K>::value || !longer(e, TreeifyAt - 1)) return;
+        //relinking the rest of the chain through the treap leaves it in tree order
+        Extra &x = more();
+        if (x.trees == NULL) x.trees = newTrees(cap);
+        Node *c = e->nxt;
+        e->nxt = NULL; x.trees[idx] = newTreeNode(e);
+        while (c != NULL){
+            Node *nxt = c->nxt;
+            link(c); c = nxt;
         }
-        for (int i = 0; i < l_cap; i ++) delete tmp[i];
-        delete [] tmp;
+    }
+    //true if the chain from e has more than n nodes
+    static bool longer(const Node *e, int n) {
+        for (; e != NULL; e = e->nxt) if (n -- == 0) return true;
+        return false;
+    }
+
+    //returns the node holding key, whose mixed hash is h, in bucket idx of b and t, counting
+    //the nodes compared in n
+    template <class Q>
+    Node *search(Node **b, TreeNode **t, int idx, const Q &key, unsigned int h, int &n) const {
+        Node *res;
+        if (t != NULL && t[idx] != NULL && treeFind(t[idx], key, h, res, n)) return res;
+        for (Node *e = b[idx]; e != NULL; e = e->nxt){
+            n ++;
+            if (e->hash == h && e->data.getKey() == key) return e;
+        }
+        return NULL;
+    }
+
+    //returns the node holding key, whose mixed hash is h, or NULL
+    template <class Q>
+    Node *findNode(const Q &key, unsigned int h) const {
+        const Extra &x = ext();
+        int n = 0;
+        if (x.bloom != NULL && !x.bloom->mayContain(h)) {if (x.counts != NULL) record(n); return NULL;}
+        Node *e = search(buckets, x.trees, index(h, cap), key, h, n);
+        if (x.counts != NULL) record(n);
+        return e != NULL ? e : findOld(key, h);
+    }
+
+    //counts a lookup that compared n nodes
+    void record(int n) const {
+        ProbeCounts *counts = extra->counts;
+        counts->lookups.fetch_add(1, std::memory_order_relaxed);
+        counts->probes.fetch_add(n, std::memory_order_relaxed);
+        int m = counts->maxProbe.load(std::memory_order_relaxed);
+        while (n > m && !counts->maxProbe.compare_exchange_weak(m, n, std::memory_order_relaxed));
+        counts->hist[n < Stats::Histogram - 1 ? n : Stats::Histogram - 1].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    //the same for the undrained part of the old bucket array only
+    template <class Q>
+    Node *findOld(const Q &key, unsigned int h) const {
+        const Extra &x = ext();
+        if (x.oldBuckets != NULL){
+            int idx = index(h, x.oldCap), n = 0;
+            if (idx >= x.migrated) return search(x.oldBuckets, x.oldTrees, idx, key, h, n);
+        }
+        return NULL;
+    }
+
+    //looks up keys[0, n) Batch at a time. A whole batch is hashed and its bucket heads
+    //prefetched, then its first nodes, and then the chains of the batch are walked in turns
+    //so that their cache misses overlap. Treeified buckets, and keys the bloom filter rules
+    //out, are searched on their own. Calls found(i, node or NULL, mixed hash) for every
+    //key, in the order of keys, once its batch is done
+    template <class F>
+    void probeBatch(const K *keys, int n, F found) const {
+        unsigned int h[Batch];
+        Node *cur[Batch], *res[Batch];
+        bool live[Batch];
+        const Extra &x = ext();
+        for (int base = 0; base < n; base += Batch){
+            int m = n - base < Batch ? n - base : Batch;
+            for (int i = 0; i < m; i ++){
+                h[i] = mix(keys[base + i]);
+                __builtin_prefetch(buckets + index(h[i], cap));
+            }
+            int left = 0;
+            for (int i = 0; i < m; i ++){
+                int idx = index(h[i], cap);
+                live[i] = (x.trees == NULL || x.trees[idx] == NULL) && (x.bloom == NULL || x.bloom->mayContain(h[i]));
+                if (!live[i]) {res[i] = findNode(keys[base + i], h[i]); continue;}
+                cur[i] = buckets[idx];
+                if (cur[i] != NULL) __builtin_prefetch(cur[i]);
+                left ++;
+            }
+            while (left > 0)
+                for (int i = 0; i < m; i ++){
+                    if (!live[i]) continue;
+                    Node *e = cur[i];
+                    if (e == NULL || (e->hash == h[i] && e->data.getKey() == keys[base + i])){
+                        res[i] = e != NULL ? e : findOld(keys[base + i], h[i]);
+                        live[i] = false; left --;
+                    }else{
+                        cur[i] = e->nxt;
+                        if (cur[i] != NULL) __builtin_prefetch(cur[i]);
+                    }
+                }
+            for (int i = 0; i < m; i ++) found(base + i, res[i], h[i]);
+        }
+    }
+
+    //links a new node for key, whose mixed hash is h, growing the table first if it is full
+    Node *insertNode(const K &key, const V &value, unsigned int h) {
+        if (sz + 1 > thereshold) rehash();
+        Node *e = newNode(Entry(key, value), NULL, h);
+        link(e);
+        sz ++;
+        BloomFilter<A> *bloom = ext().bloom;
+        if (bloom != NULL){
+            bloom->add(h);
+            if (bloom->size() > bloom->capacity()) rebuildBloom(2 * sz);
+        }
+        return e;
+    }
+
+    //refills the bloom filter, sized for at least n keys, from the keys in the map
+    void rebuildBloom(int n) {
+        const Extra &x = *extra;
+        x.bloom->reset(n > x.bloom->capacity() ? n : x.bloom->capacity());
+        for (int i = 0; i < cap; i ++)
+            for (Node *e = buckets[i]; e != NULL; e = e->nxt) x.bloom->add(e->hash);
+        if (x.oldBuckets != NULL)
+            for (int i = x.migrated; i < x.oldCap; i ++)
+                for (Node *e = x.oldBuckets[i]; e != NULL; e = e->nxt) x.bloom->add(e->hash);
+    }
+    void deleteBloom() {
+        if (extra == NULL || extra->bloom == NULL) return;
+        extra->bloom->~BloomFilter<A>();
+        alloc.deallocate(extra->bloom, sizeof(BloomFilter<A>));
+        extra->bloom = NULL;
+    }
+    void copyBloom(const HashMap &x) {
+        if (x.ext().bloom == NULL) return;
+        more().bloom = new (alloc.allocate(sizeof(BloomFilter<A>))) BloomFilter<A>(*x.extra->bloom);
+    }
+
+    //unlinks and frees the node holding key, whose mixed hash is h, from b and t
+    template <class Q>
+    bool unlink(Node **b, TreeNode **t, int c, const Q &key, unsigned int h) {
+        int idx = index(h, c), n = 0;
+        TreeNode *root = t != NULL ? t[idx] : NULL;
+        Node *e, *last = NULL;
+        if (root != NULL && treeFind(root, key, h, e, n)){
+            if (e != NULL) last = treePred(root, e);
+        }else{
+            for (e = b[idx]; e != NULL && !(e->hash == h && e->data.getKey() == key); last = e, e = e->nxt);
+        }
+        if (e == NULL) return false;
+        unlinkNode(b, t, idx, e, last);
+        return true;
+    }
+
+    //unlinks and frees e, which follows last (NULL at the head) in bucket idx of b and t
+    void unlinkNode(Node **b, TreeNode **t, int idx, Node *e, Node *last) {
+        if (last != NULL) last->nxt = e->nxt;
+            else b[idx] = e->nxt;
+        if (t != NULL && t[idx] != NULL){
+            treeErase(t[idx], e);
+            if (!longer(b[idx], UntreeifyAt)) {deleteTree(t[idx]); t[idx] = NULL;}
+        }
+        sz --;
+        deleteNode(e);
+    }
+
+    //removes key from whichever bucket array holds it
+    template <class Q>
+    bool removeKey(const Q &key) {
+        migrate();
+        unsigned int h = mix(key);
+        const Extra &x = ext();
+        if (unlink(buckets, x.trees, cap, key, h)) return true;
+        if (x.oldBuckets == NULL || index(h, x.oldCap) < x.migrated) return false;
+        return unlink(x.oldBuckets, x.oldTrees, x.oldCap, key, h);
+    }
+
+    //the murmur3 finalizer, spreads every bit of the hash code over the low bits. A 64-bit
+    //hash is taken as well mixed and only folded
+    template <class Q>
+    static unsigned int mix(const Q &key) {
+        if (WideHash<H, Q>::value) {unsigned long long x = hashOf<H>(key); return x ^ (x >> 32);}
+        unsigned int h = H::hashCode(key);
+        h ^= h >> 16; h *= 0x85ebca6bu;
+        h ^= h >> 13; h *= 0xc2b2ae35u;
+        h ^= h >> 16;
+        return h;
+    }
+
+    static int index(unsigned int h, int c) {
+        return h & (c - 1);
+    }
+
+    //a load factor outside (0, 1], or NaN, would keep capacityFor() doubling forever
+    static void checkFactor(double f) {
+        if (!(f > 0 && f <= 1)) throw std::invalid_argument("\nIllegal Load Factor\n");
+    }
+
+    //the smallest capacity, 1 or a power of two of at least D_cap, that holds n entries
+    //without growing, or MaxCap
+    int capacityFor(int n) const {
+        if (n <= SmallMax) return 1;
+        int c = D_cap;
+        while ((int)(c * ext().factor) < n && c < MaxCap) c *= 2;
+        return c;
+    }
+
+    //relinks the nodes of a chain into the current bucket array
+    void moveChain(Node *e) {
+        while (e != NULL){
+            Node *nxt = e->nxt;
+            link(e);
+            e = nxt;
+        }
+    }
+
+    //moves the next n buckets of a resize in progress, freeing the old array once it is
+    //empty. migrate(MaxCap) finishes the resize
+    void migrate(int n = MigrateStep) {
+        if (extra == NULL || extra->oldBuckets == NULL) return;
+        Extra &x = *extra;
+        for (; n > 0 && x.migrated < x.oldCap; n --, x.migrated ++){
+            if (x.oldTrees != NULL) {deleteTree(x.oldTrees[x.migrated]); x.oldTrees[x.migrated] = NULL;}
+            moveChain(x.oldBuckets[x.migrated]);
+            x.oldBuckets[x.migrated] = NULL;
+        }
+        if (x.migrated == x.oldCap){
+            deleteBuckets(x.oldBuckets, x.oldCap);
+            deleteTrees(x.oldTrees, x.oldCap, x.oldCap);
+            x.oldBuckets = NULL; x.oldTrees = NULL;
+        }
+    }
+
+    //resizes the bucket array to newCap buckets, doubling it by default and leaving the
+    //inline bucket for D_cap buckets, reusing the nodes.
+    //In incremental mode the old array is left for migrate() to drain. Zero-filling the new
+    //array, and draining a previous resize if one is pending, still cost O(capacity) here
+    void rehash(int newCap = 0){
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        Extra &x = more();
+        migrate(MaxCap);
+        Node** tmp = buckets;
+        int l_cap = cap;
+        cap = newCap ? newCap : cap == 1 ? D_cap : 2 * cap;
+        buckets = bucketsFor(cap);
+        thereshold = limit(cap);
+        x.oldBuckets = tmp; x.oldCap = l_cap; x.migrated = 0;
+        x.oldTrees = x.trees; x.trees = NULL;
+        if (!x.incremental) migrate(MaxCap);
+        x.rehashes ++;
+        x.rehashSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
     }
 
     class Iterator
     {
-        Node** buckets;
-        int idx, cap;
+        const HashMap *map;
+        int idx;
         Node* cur; 
-        Entry res;
+
+        //the buckets of the new array followed by the undrained buckets of the old one
+        int buckets() const {
+            const Extra &x = map->ext();
+            return map->cap + (x.oldBuckets == NULL ? 0 : x.oldCap - x.migrated);
+        }
+        Node *bucket(int i) const {return i < map->cap ? map->buckets[i] : map->extra->oldBuckets[map->extra->migrated + i - map->cap];}
     public:
-        void init(Node** _B, int _C){buckets = _B; cap = _C; idx = -1; cur = NULL;}
+        void init(const HashMap *_m){map = _m; idx = -1; cur = NULL;}
         /**
          * TODO Returns true if the iteration has more elements.
          */
         bool hasNext() {
             while (cur == NULL){
-                idx ++; if (idx >= cap) return 0;
-                cur = buckets[idx];
+                idx ++; if (idx >= buckets()) return 0;
+                cur = bucket(idx);
             }
             return 1;
         }
@@ -146,77 +735,147 @@ public:
         const Entry &next() {
             if (!hasNext()) throw ElementNotExist("\nNo Such Element.\n");
             while (cur == NULL){
-                idx ++; cur = buckets[idx];
+                idx ++; cur = bucket(idx);
             }
-            res = cur->data;
+            const Entry &res = cur->data;
             cur = cur->nxt;
             return res; 
         }
     };
 
+    /**
+     * An iterator that hands out the stored entries themselves, so their values can be
+     * changed in place, and that can remove the entry it returned last. Nothing else may
+     * change the map while it is in use, and the keys must not be changed.
+     */
+    class MutableIterator
+    {
+        HashMap *map;
+        int idx, lastIdx;
+        //cur follows prev in bucket idx, last follows lastPrev in bucket lastIdx
+        Node *cur, *prev, *last, *lastPrev;
+
+        int buckets() const {
+            const Extra &x = map->ext();
+            return map->cap + (x.oldBuckets == NULL ? 0 : x.oldCap - x.migrated);
+        }
+        Node **bucket(int i) const {return i < map->cap ? map->buckets + i : map->extra->oldBuckets + map->extra->migrated + i - map->cap;}
+    public:
+        void init(HashMap *_m){map = _m; idx = lastIdx = -1; cur = prev = last = lastPrev = NULL;}
+        /**
+         * Returns true if the iteration has more elements.
+         */
+        bool hasNext() {
+            while (cur == NULL){
+                if (idx + 1 >= buckets()) return 0;
+                idx ++; cur = *bucket(idx); prev = NULL;
+            }
+            return 1;
+        }
+
+        /**
+         * Returns the next element in the iteration.
+         * @throw ElementNotExist exception when hasNext() == false
+         */
+        Entry &next() {
+            if (!hasNext()) throw ElementNotExist("\nNo Such Element.\n");
+            last = cur; lastPrev = prev; lastIdx = idx;
+            prev = cur; cur = cur->nxt;
+            return last->data;
+        }
+
+        /**
+         * Removes the element returned by the last call to next() from the map, without
+         * looking it up again.
+         * @throw ElementNotExist exception when next() has not been called since the
+         * last remove()
+         */
+        void remove() {
+            if (last == NULL) throw ElementNotExist("\nNo Such Element.\n");
+            const Extra &x = map->ext();
+            if (lastIdx < map->cap) map->unlinkNode(map->buckets, x.trees, lastIdx, last, lastPrev);
+                else map->unlinkNode(x.oldBuckets, x.oldTrees, x.migrated + lastIdx - map->cap, last, lastPrev);
+            if (prev == last) prev = lastPrev;
+            last = NULL;
+        }
+    };
+
     /**
      * TODO Constructs an empty hash map.
      */
     HashMap() {
-        cap = D_cap;
-        thereshold = cap * Factor;
+        extra = NULL;
+        cap = 1;
+        thereshold = limit(cap);
+        sz = 0;
+        buckets = bucketsFor(cap);
+    }
+
+    /**
+     * Constructs an empty hash map drawing memory from the allocator a.
+     */
+    explicit HashMap(const A &a): alloc(a) {
+        extra = NULL;
+        cap = 1;
+        thereshold = limit(cap);
+        sz = 0;
+        buckets = bucketsFor(cap);
+    }
+
+    /**
+     * Constructs an empty hash map that holds expectedSize entries without rehashing, growing
+     * once its size passes capacity times loadFactor.
+     * @throw std::invalid_argument unless 0 < loadFactor <= 1
+     */
+    explicit HashMap(int expectedSize, double loadFactor = 0.75, const A &a = A()): alloc(a) {
+        checkFactor(loadFactor);
+        extra = NULL;
+        setFactor(loadFactor);
+        cap = capacityFor(expectedSize);
+        thereshold = limit(cap);
         sz = 0;
-        buckets = new Node* [cap];
-        for (int i = 0; i < cap; i ++) buckets[i] = NULL;
+        buckets = bucketsFor(cap);
     }
 
     /**
      * TODO Destructor
      */
     ~HashMap() { 
-        for (int i = 0; i < cap; i ++){
-            Node *e = buckets[i];
-            while (e != NULL){
-                Node *tmp = e->nxt;
-                delete e; e = tmp;
-            }
-        } 
-        delete [] buckets;
+        deleteAll();
+        setProbeCounting(false);
+        deleteBloom();
+        deleteExtra();
     }
 
     /**
      * TODO Assignment operator
      */
     HashMap &operator=(const HashMap &x) {
-        if (x == *this) return *this;
-        for (int i = 0; i < cap; i ++) delete buckets[i];
-        delete [] buckets;
+        if (&x == this) return *this;
+        deleteAll();
         cap = x.cap;
+        setFactor(x.ext().factor);
         thereshold = x.thereshold;
         sz = x.sz;
-        buckets = new Node* [cap];
-        for (int i = 0; i < cap; i ++){
-            buckets[i] = NULL;
-            Node *cur = buckets[i], *e = x.buckets[i];
-            while (e != NULL){
-                cur = new Node(e->data, buckets[i]);
-                buckets[i] = cur; e = e->nxt;            
-            } 
-        }
+        copyBuckets(x);
+        deleteBloom();
+        copyBloom(x);
         return *this;
     }
 
     /**
      * TODO Copy-constructor
      */
-    HashMap(const HashMap &x) { 
+    HashMap(const HashMap &x): alloc(x.alloc) { 
+        extra = NULL;
         cap = x.cap;
+        setFactor(x.ext().factor);
         thereshold = x.thereshold;
         sz = x.sz;
-        buckets = new Node* [cap];
-        for (int i = 0; i < cap; i ++){
-            buckets[i] = NULL;
-            Node *cur = NULL, *e = x.buckets[i];
-            while (e != NULL){
-                cur = new Node(e->data, buckets[i]);
-                buckets[i] = cur; e = e->nxt;            
-            } 
-        }
+        if (x.ext().incremental) more().incremental = true;
+        setProbeCounting(x.ext().counts != NULL);
+        copyBuckets(x);
+        copyBloom(x);
      }
 
     /**
@@ -224,7 +883,16 @@ public:
      */
     Iterator iterator() const {
         Iterator iter;
-        iter.init(buckets, cap);
+        iter.init(this);
+        return iter;
+    }
+
+    /**
+     * Returns an iterator that can change values and remove entries, see MutableIterator.
+     */
+    MutableIterator mutableIterator() {
+        MutableIterator iter;
+        iter.init(this);
         return iter;
     }
 
@@ -232,24 +900,56 @@ public:
      * TODO Removes all of the mappings from this map.
      */
     void clear() {
-        for (int i = 0; i < cap; i ++) delete buckets[i];
-        delete [] buckets;
-        cap = D_cap;
-        thereshold = cap * Factor;
-        buckets = new Node* [cap];
-        for (int i = 0; i < cap; i ++) buckets[i] = NULL;
+        deleteAll();
+        cap = 1;
+        thereshold = limit(cap);
+        sz = 0;
+        buckets = bucketsFor(cap);
+        if (ext().bloom != NULL) extra->bloom->clear();
+    }
+
+    /**
+     * Makes sure that n entries fit without further rehashing. A resize in progress is
+     * finished first.
+     */
+    void reserve(int n) {
+        migrate(MaxCap);
+        if (n > thereshold){
+            rehash(capacityFor(n));
+            migrate(MaxCap);
+        }
+    }
+
+    /**
+     * Sets the load factor and grows the table at once if it is already above the new limit.
+     * @throw std::invalid_argument unless 0 < loadFactor <= 1
+     */
+    void setLoadFactor(double loadFactor) {
+        checkFactor(loadFactor);
+        setFactor(loadFactor);
+        thereshold = limit(cap);
+        if (sz > thereshold) reserve(sz);
     }
 
+    /**
+     * Returns the load factor of this map.
+     */
+    double getLoadFactor() const {return ext().factor;}
+
     /**
      * TODO Returns true if this map contains a mapping for the specified key.
      */
     bool containsKey(const K &key) const {
-        int idx = hash(key);
-        Node *e = buckets[idx];
-        for (;e != NULL; e = e->nxt){
-            if (e->data.getKey() == key) return true; 
-        }
-        return false;
+        return findNode(key, mix(key)) != NULL;
+    }
+
+    /**
+     * Returns true if this map contains a mapping for a key equal to key, which need not be
+     * a K. Only available when H is transparent.
+     */
+    template <class Q, class HH = H, class = Probe<Q, HH> >
+    bool containsKey(const Q &key) const {
+        return findNode(key, mix(key)) != NULL;
     }
 
     /**
@@ -262,6 +962,11 @@ public:
                 if (e->data.getValue() == value) return true; 
             }
         }
+        const Extra &x = ext();
+        if (x.oldBuckets != NULL)
+            for (int i = x.migrated; i < x.oldCap; i ++)
+                for (Node *e = x.oldBuckets[i]; e != NULL; e = e->nxt)
+                    if (e->data.getValue() == value) return true;
         return false;
     }
 
@@ -271,38 +976,215 @@ public:
      * @throw ElementNotExist
      */
     const V &get(const K &key) const {
-        if (!containsKey(key)) throw ElementNotExist("\nNo Such Element.\n");
-        int idx = hash(key);
-        Node *e = buckets[idx];
-        for (;e != NULL; e = e->nxt){
-            if (e->data.getKey() == key) return e->data.getValue2(); 
-        }
+        Node *e = findNode(key, mix(key));
+        if (e == NULL) throw ElementNotExist("\nNo Such Element.\n");
+        return e->data.getValue2();
+    }
+
+    /**
+     * Returns a const reference to the value mapped to a key equal to key, which need not
+     * be a K. Only available when H is transparent.
+     * @throw ElementNotExist
+     */
+    template <class Q, class HH = H, class = Probe<Q, HH> >
+    const V &get(const Q &key) const {
+        Node *e = findNode(key, mix(key));
+        if (e == NULL) throw ElementNotExist("\nNo Such Element.\n");
         return e->data.getValue2();
     }
 
+    /**
+     * Returns a pointer to the value to which the specified key is mapped, or NULL if the
+     * key is not present. The pointer stays valid until the key is removed.
+     */
+    V *find(const K &key) {
+        Node *e = findNode(key, mix(key));
+        return e == NULL ? NULL : &e->data.getValue2();
+    }
+
+    /**
+     * Returns a pointer to the value to which the specified key is mapped, or NULL if the
+     * key is not present.
+     */
+    const V *find(const K &key) const {
+        Node *e = findNode(key, mix(key));
+        return e == NULL ? NULL : &e->data.getValue2();
+    }
+
+    /**
+     * Returns a pointer to the value mapped to a key equal to key, which need not be a K,
+     * or NULL. Only available when H is transparent.
+     */
+    template <class Q, class HH = H, class = Probe<Q, HH> >
+    V *find(const Q &key) {
+        Node *e = findNode(key, mix(key));
+        return e == NULL ? NULL : &e->data.getValue2();
+    }
+
+    /**
+     * Returns a pointer to the value mapped to a key equal to key, which need not be a K,
+     * or NULL. Only available when H is transparent.
+     */
+    template <class Q, class HH = H, class = Probe<Q, HH> >
+    const V *find(const Q &key) const {
+        Node *e = findNode(key, mix(key));
+        return e == NULL ? NULL : &e->data.getValue2();
+    }
+
+    /**
+     * Returns the value to which the specified key is mapped, or def if the key is not present.
+     */
+    V getOrDefault(const K &key, const V &def) const {
+        Node *e = findNode(key, mix(key));
+        return e == NULL ? def : e->data.getValue2();
+    }
+
     /**
      * TODO Returns true if this map contains no key-value mappings.
      */
     bool isEmpty() const {
-        for (int i = 0; i < cap; i ++) if (buckets[i] != NULL) return 0;
-        return 1;
+        return sz == 0;
     }
 
     /**
      * TODO Associates the specified value with the specified key in this map.
      */
     void put(const K &key, const V &value) {
-        int idx = hash(key);
-        Node *e = buckets[idx];
-       // std::cout<<"tt"<<" "<<idx<<" "<<cap<<std::endl;
-        
-        for (;e != NULL;e = e->nxt){
-            if (e->data.getKey() == key) {e->data = Entry(key, value); return ;} 
+        migrate();
+        unsigned int h = mix(key);
+        Node *e = findNode(key, h);
+        if (e != NULL) e->data.getValue2() = value;
+            else insertNode(key, value, h);
+    }
+
+    /**
+     * Associates the specified value with the specified key if the key is not present yet.
+     * Returns true if the value was inserted, false if the map is left unchanged.
+     */
+    bool putIfAbsent(const K &key, const V &value) {
+        migrate();
+        unsigned int h = mix(key);
+        if (findNode(key, h) != NULL) return false;
+        insertNode(key, value, h);
+        return true;
+    }
+
+    /**
+     * Returns a reference to the value mapped to the specified key. If the key is not
+     * present, fn(key) is called first and its result inserted.
+     */
+    template <class F>
+    V &computeIfAbsent(const K &key, F fn) {
+        migrate();
+        unsigned int h = mix(key);
+        Node *e = findNode(key, h);
+        if (e == NULL) e = insertNode(key, fn(key), h);
+        return e->data.getValue2();
+    }
+
+    /**
+     * Maps the specified key to value if it is not present, and to fn(old value, value)
+     * otherwise. Returns a reference to the new value.
+     */
+    template <class F>
+    V &merge(const K &key, const V &value, F fn) {
+        migrate();
+        unsigned int h = mix(key);
+        Node *e = findNode(key, h);
+        if (e == NULL) e = insertNode(key, value, h);
+            else e->data.getValue2() = fn(e->data.getValue2(), value);
+        return e->data.getValue2();
+    }
+
+    /**
+     * Looks up n keys at once, overlapping their memory accesses. out[i] is set to a pointer
+     * to the value of keys[i], or NULL if it is not present. Returns the number of keys found.
+     */
+    int multiGet(const K *keys, int n, const V **out) const {
+        int cnt = 0;
+        probeBatch(keys, n, [&](int i, Node *e, unsigned int){
+            out[i] = e == NULL ? NULL : &e->data.getValue2();
+            if (e != NULL) cnt ++;
+        });
+        return cnt;
+    }
+
+    /**
+     * Looks up n keys at once, overlapping their memory accesses. out[i] is set to true if
+     * keys[i] is present. Returns the number of keys found.
+     */
+    int multiContains(const K *keys, int n, bool *out) const {
+        int cnt = 0;
+        probeBatch(keys, n, [&](int i, Node *e, unsigned int){
+            out[i] = e != NULL;
+            if (e != NULL) cnt ++;
+        });
+        return cnt;
+    }
+
+    /**
+     * Puts n pairs (keys[i], values[i]) at once, as n calls to put() in order would. The
+     * lookups are overlapped as in multiGet(), and the table grows only for the keys that
+     * turn out to be missing, so updating keys already present never resizes it.
+     */
+    void multiPut(const K *keys, const V *values, int n) {
+        if (sz == 0) reserve(n);
+        Node *found[Batch];
+        unsigned int h[Batch];
+        for (int base = 0; base < n; base += Batch){
+            int m = n - base < Batch ? n - base : Batch, miss = 0;
+            probeBatch(keys + base, m, [&](int i, Node *e, unsigned int hi){
+                found[i] = e; h[i] = hi;
+                if (e == NULL) miss ++;
+            });
+            //resizing moves nodes without freeing them, so found stays valid
+            reserve(sz + miss);
+            //the hashes of the keys of this batch inserted so far
+            unsigned int added[Batch];
+            int na = 0;
+            for (int i = 0; i < m; i ++){
+                const K &key = keys[base + i];
+                Node *e = found[i];
+                //the key may have been inserted by an earlier pair of the same batch, which the
+                //batched lookup did not see; only then is it looked up again
+                if (e == NULL)
+                    for (int j = 0; j < na; j ++)
+                        if (added[j] == h[i]) {e = findNode(key, h[i]); break;}
+                if (e != NULL) e->data.getValue2() = values[base + i];
+                    else {insertNode(key, values[base + i], h[i]); added[na ++] = h[i];}
+            }
+        }
+    }
+
+    /**
+     * Puts every pair in [first, last), a forward range of elements with members first
+     * and second, into this map as put() would. An empty map is sized for the whole range
+     * up front. The keys are looked up Batch at a time with their buckets prefetched, and
+     * the table grows only for the ones that are missing before any of them is linked.
+     */
+    template <class It>
+    void putAll(It first, It last) {
+        if (sz == 0) reserve((int)std::distance(first, last));
+        unsigned int h[Batch];
+        Node *found[Batch];
+        while (first != last){
+            It it = first;
+            int n = 0, miss = 0;
+            for (; n < Batch && it != last; n ++, ++ it){
+                h[n] = mix(it->first);
+                __builtin_prefetch(buckets + index(h[n], cap));
+            }
+            it = first;
+            for (int i = 0; i < n; i ++, ++ it)
+                if ((found[i] = findNode(it->first, h[i])) == NULL) miss ++;
+            reserve(sz + miss);
+            for (int i = 0; i < n; i ++, ++ first){
+                //a miss may be a key inserted earlier in this batch, so it is looked up again
+                Node *e = found[i] != NULL ? found[i] : findNode(first->first, h[i]);
+                if (e != NULL) e->data.getValue2() = first->second;
+                    else insertNode(first->first, first->second, h[i]);
+            }
         }
-        //std::cout<<"tt"<<std::endl;
-        e = new Node(Entry(key, value), buckets[idx]);
-        buckets[idx] = e;
-        if (++sz > thereshold) rehash();
     }
 
     /**
@@ -311,20 +1193,143 @@ public:
      * @throw ElementNotExist
      */
     void remove(const K &key) {
-        int idx = hash(key);
-        if (!containsKey(key)) throw ElementNotExist("\nNo Such Element.\n");
-        Node *e = buckets[idx], *last = NULL;
-        for (;e != NULL;last = e, e = e->nxt){
-            if (e->data.getKey() == key) {
-                if (last != NULL) last->nxt = e->nxt;
-                    else buckets[idx] = e->nxt;
-                sz --;
-                delete e;
-                return ;
+        if (!tryRemove(key)) throw ElementNotExist("\nNo Such Element.\n");
+    }
+
+    /**
+     * Removes the mapping for the specified key from this map if present.
+     * Returns true if there was one, otherwise false.
+     */
+    bool tryRemove(const K &key) {
+        return removeKey(key);
+    }
+
+    /**
+     * Removes the mapping for a key equal to key, which need not be a K, if present.
+     * Returns true if there was one. Only available when H is transparent.
+     */
+    template <class Q, class HH = H, class = Probe<Q, HH> >
+    bool tryRemove(const Q &key) {
+        return removeKey(key);
+    }
+
+    /**
+     * Removes every entry e for which pred(e) is true in one pass over the table, and
+     * returns the number of entries removed.
+     */
+    template <class F>
+    int removeIf(F pred) {
+        int cnt = 0;
+        for (MutableIterator it = mutableIterator(); it.hasNext(); )
+            if (pred(static_cast<const Entry &>(it.next()))) {it.remove(); cnt ++;}
+        return cnt;
+    }
+
+    /**
+     * Turns incremental resizing on or off. Turning it off finishes a resize in progress.
+     */
+    void setIncrementalRehash(bool on) {
+        if (on != ext().incremental) more().incremental = on;
+        if (!on) migrate(MaxCap);
+    }
+
+    /**
+     * Returns true if this map resizes incrementally.
+     */
+    bool isIncrementalRehash() const {return ext().incremental;}
+
+    /**
+     * Returns the shape of the table, the rehash counters and, in probe counting mode, the
+     * probe counters. Walks the whole table. During an incremental resize the buckets of
+     * the old array that are not drained yet count as buckets too.
+     */
+    Stats stats() const {
+        Stats s;
+        s.buckets = cap; s.size = sz;
+        s.loadFactor = (double)sz / cap;
+        s.maxChain = 0; s.treeBuckets = 0;
+        for (int i = 0; i < Stats::Histogram; i ++) s.chainHistogram[i] = s.probeHistogram[i] = 0;
+        std::vector<unsigned int> hashes;
+        hashes.reserve(sz);
+        long long probeSum = 0;
+        const Extra &x = ext();
+        int empty = 0, all = cap + (x.oldBuckets == NULL ? 0 : x.oldCap - x.migrated);
+        for (int i = 0; i < all; i ++){
+            int n = 0, j = i < cap ? i : x.migrated + i - cap;
+            TreeNode **t = i < cap ? x.trees : x.oldTrees;
+            if (t != NULL && t[j] != NULL) s.treeBuckets ++;
+            for (Node *e = (i < cap ? buckets : x.oldBuckets)[j]; e != NULL; e = e->nxt){
+                n ++;
+                hashes.push_back(e->hash);
             }
+            if (n == 0) empty ++;
+            if (n > s.maxChain) s.maxChain = n;
+            s.chainHistogram[n < Stats::Histogram - 1 ? n : Stats::Histogram - 1] ++;
+            probeSum += (long long)n * (n + 1) / 2;
+        }
+        std::sort(hashes.begin(), hashes.end());
+        s.distinctHashes = std::unique(hashes.begin(), hashes.end()) - hashes.begin();
+        s.buckets = all;
+        s.emptyRatio = (double)empty / all;
+        s.meanProbe = sz ? (double)probeSum / sz : 0;
+        s.rehashes = x.rehashes; s.rehashSeconds = x.rehashSeconds;
+        s.lookups = s.probes = 0; s.maxProbe = 0;
+        if (x.counts != NULL){
+            s.lookups = x.counts->lookups.load(std::memory_order_relaxed);
+            s.probes = x.counts->probes.load(std::memory_order_relaxed);
+            s.maxProbe = x.counts->maxProbe.load(std::memory_order_relaxed);
+            for (int i = 0; i < Stats::Histogram; i ++) s.probeHistogram[i] = x.counts->hist[i].load(std::memory_order_relaxed);
+        }
+        return s;
+    }
+
+    /**
+     * Turns probe counting on or off, see stats(). Turning it off drops the counters.
+     */
+    void setProbeCounting(bool on) {
+        if (on && ext().counts == NULL){
+            more().counts = new (alloc.allocate(sizeof(ProbeCounts))) ProbeCounts;
+            resetProbeCounts();
+        }else if (!on && ext().counts != NULL){
+            extra->counts->~ProbeCounts();
+            alloc.deallocate(extra->counts, sizeof(ProbeCounts));
+            extra->counts = NULL;
         }
     }
 
+    /**
+     * Sets the probe counters back to zero.
+     */
+    void resetProbeCounts() {
+        ProbeCounts *counts = ext().counts;
+        if (counts == NULL) return;
+        counts->lookups.store(0, std::memory_order_relaxed);
+        counts->probes.store(0, std::memory_order_relaxed);
+        counts->maxProbe.store(0, std::memory_order_relaxed);
+        for (int i = 0; i < Stats::Histogram; i ++) counts->hist[i].store(0, std::memory_order_relaxed);
+    }
+
+    /**
+     * Adds a bloom filter sized for expectedSize keys, or for the current size if that is
+     * larger, see the class documentation. An expectedSize of 0 or less removes the filter.
+     */
+    void setBloomFilter(int expectedSize) {
+        deleteBloom();
+        if (expectedSize <= 0) return;
+        more().bloom = new (alloc.allocate(sizeof(BloomFilter<A>))) BloomFilter<A>(expectedSize, alloc);
+        rebuildBloom(sz);
+    }
+
+    /**
+     * Returns true if this map has a bloom filter.
+     */
+    bool hasBloomFilter() const {return ext().bloom != NULL;}
+
+    /**
+     * Returns the allocator of this map.
+     */
+    A getAllocator() const {return alloc;}
+
     /**
      * TODO Returns the number of key-value mappings in this map.
      */
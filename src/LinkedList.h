@@ -4,23 +4,46 @@
 
 #include "IndexOutOfBound.h"
 #include "ElementNotExist.h"
+#include "Allocator.h"
 #include <iostream>
+#include <new>
+#include <type_traits>
 
 /**
  * A linked list.
  *
+ * Nodes are allocated from the allocator A, see Allocator.h.
+ *
  * The iterator iterates in the order of the elements being loaded into this list.
  */
-template <class T>
+template <class T, class A = HeapAllocator>
 class LinkedList
 {
     struct Node{
         T data;
         Node *nxt, *pre;
-        Node(T _d = 0, Node *_n = NULL, Node *_p = NULL): data(_d), nxt(_n), pre(_p){}
+        Node(const T &_d, Node *_n = NULL, Node *_p = NULL): data(_d), nxt(_n), pre(_p){}
     };
     Node *front, *rear;
     int sze;
+    A alloc;
+
+    Node *newNode(const T &_d, Node *_n, Node *_p) {
+        void *p = alloc.allocate(sizeof(Node));
+        return new (p) Node(_d, _n, _p);
+    }
+    void deleteNode(Node *p) {
+        p->~Node();
+        alloc.deallocate(p, sizeof(Node));
+    }
+    //frees every node, unless the allocator frees nothing and the nodes need no destructor
+    void deleteAll() {
+        if (A::noopDeallocate && std::is_trivially_destructible<T>::value) return;
+        for (Node *tmp = front; tmp != NULL;){
+            Node *cur = tmp;
+            tmp = tmp->nxt; deleteNode(cur);
+        }
+    }
 
 public:
     //checked
@@ -64,16 +87,20 @@ public:
      */
     LinkedList() {front = rear = NULL; sze = 0;}
 
+    /**
+     * Constructs an empty linked list drawing nodes from the allocator a.
+     */
+    explicit LinkedList(const A &a): alloc(a) {front = rear = NULL; sze = 0;}
+
     /**
      * TODO Copy constructor
      */
     //checked
-    LinkedList(const LinkedList<T> &c) {
-        Node *last = NULL, *tmp = front;
-        tmp = NULL; front = NULL;
+    LinkedList(const LinkedList &c): alloc(c.alloc) {
+        Node *last = NULL, *tmp = NULL;
+        front = NULL;
         for (Node *cur = c.front; cur != NULL; cur = cur->nxt){
-            tmp = new Node;
-            tmp->pre = last; tmp->data = cur->data;
+            tmp = newNode(cur->data, NULL, last);
             if (tmp->pre != NULL) tmp->pre->nxt = tmp; else front = tmp;
             last = tmp;
         } 
@@ -85,18 +112,13 @@ public:
      * TODO Assignment operator
      */
     //checked
-    LinkedList<T>& operator=(const LinkedList<T> &c) {
-        if (c == *this) return *this;
-        Node *last = NULL, *tmp = front;
-        for (;tmp != NULL; ){
-            Node *cur = tmp;
-            tmp = tmp->nxt;
-            delete cur;
-        }
-        tmp = NULL; front = NULL;
+    LinkedList& operator=(const LinkedList &c) {
+        if (&c == this) return *this;
+        Node *last = NULL, *tmp = NULL;
+        deleteAll();
+        front = NULL;
         for (Node *cur = c.front; cur != NULL; cur = cur->nxt){
-            tmp = new Node;
-            tmp->pre = last; tmp->data = cur->data;
+            tmp = newNode(cur->data, NULL, last);
             if (tmp->pre != NULL) tmp->pre->nxt = tmp; else front = tmp;
             last = tmp;
         } 
@@ -109,19 +131,15 @@ public:
      * TODO Desturctor
      */
     ~LinkedList() {
-        Node *tmp = front;
-        for (;tmp != NULL;){
-            Node *cur = tmp;
-            tmp = tmp->nxt; delete cur;
-        }
+        deleteAll();
     }
 
     /**
      * TODO Appends the specified element to the end of this list.
      */
     bool add(const T& e) {//checked
-        if (front == NULL) front = rear = new Node(e, NULL, NULL); 
-            else {rear->nxt = new Node(e, NULL, rear); rear = rear->nxt;} 
+        if (front == NULL) front = rear = newNode(e, NULL, NULL); 
+            else {rear->nxt = newNode(e, NULL, rear); rear = rear->nxt;} 
         sze ++;
         return true;
     }
@@ -130,7 +148,8 @@ public:
      * TODO Inserts the specified element to the beginning of this list.
      */
     void addFirst(const T& elem) {//checked
-        front = new Node(elem, front, NULL);
+        front = newNode(elem, front, NULL);
+        if (front->nxt != NULL) front->nxt->pre = front;
         if (rear == NULL) rear = front;
         sze ++;
     }
@@ -142,9 +161,9 @@ public:
     void addLast(const T &elem) {//checked
         if (rear == NULL) {
             sze ++;
-            rear = new Node(elem, NULL, rear); front = rear; return;
+            rear = newNode(elem, NULL, rear); front = rear; return;
         }
-        rear->nxt = new Node(elem, NULL, rear); rear = rear->nxt;
+        rear->nxt = newNode(elem, NULL, rear); rear = rear->nxt;
         if (front == NULL) front = rear; 
         sze ++;
     }
@@ -159,7 +178,7 @@ public:
         int cur = 0; 
         for (Node *tmp = front; tmp != NULL; tmp = tmp->nxt, cur ++){
             if (cur == index){
-                Node *New = new Node(element, tmp, tmp->pre);
+                Node *New = newNode(element, tmp, tmp->pre);
                 if (tmp->pre == NULL) front = New;
                     else tmp->pre->nxt = New;
                 tmp->pre = New;
@@ -168,8 +187,8 @@ public:
             }
         }
         if (cur == index){
-            Node *New = new Node(element, rear, NULL);
-            rear->nxt = New;
+            Node *New = newNode(element, NULL, rear);
+            if (rear != NULL) rear->nxt = New; else front = New;
             sze ++;
             rear = New; return ;
         }
@@ -180,11 +199,7 @@ public:
      * TODO Removes all of the elements from this list.
      */
     void clear() {
-        Node *tmp = front;
-        for (;tmp != NULL;){
-            Node *cur = tmp;
-            tmp = tmp->nxt; delete cur;
-        }
+        deleteAll();
         front = rear = NULL;
         sze = 0;
     }
@@ -237,7 +252,7 @@ public:
         if (P != NULL) P->nxt = N; else front = N;
         if (N != NULL) N->pre = P; else rear = P;
         sze --;
-        delete cur;
+        deleteNode(cur);
     }
 
     /**
@@ -255,6 +270,7 @@ public:
                 if (tmp->nxt == NULL) rear = tmp->pre;
                     else tmp->nxt->pre = tmp->pre;
                 sze --;
+                deleteNode(tmp);
                 return ;
             }
         }
@@ -275,6 +291,7 @@ public:
                 if (tmp->nxt == NULL) rear = tmp->pre;
                     else tmp->nxt->pre = tmp->pre;
                 sze --;
+                deleteNode(tmp);
                 return true;
             }
         }
@@ -291,7 +308,7 @@ public:
         Node *tmp = front;
         sze --;
         front = front->nxt;if (front != NULL) front->pre = NULL; else rear = front;
-        delete tmp;
+        deleteNode(tmp);
     }
 
     /**
@@ -304,7 +321,7 @@ public:
         Node *tmp = rear;
         sze --;
         rear = rear->pre; if (rear != NULL) rear->nxt = NULL; else front = rear;
-        delete tmp;
+        deleteNode(tmp);
     }
 
     /**
@@ -330,6 +347,11 @@ public:
         return sze;
     }
 
+    /**
+     * Returns the allocator of this list.
+     */
+    A getAllocator() const {return alloc;}
+
     /**
      * TODO Returns an iterator over the elements in this list.
      */
@@ -0,0 +1,299 @@
+/** @file */
+#ifndef __MAPPEDARRAYLIST_H
+#define __MAPPEDARRAYLIST_H
+
+#include "IndexOutOfBound.h"
+#include "ElementNotExist.h"
+#include "SimdSearch.h"
+#include <climits>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * MappedArrayList is an ArrayList whose array lives in a memory-mapped file.
+ *
+ * The file starts with a small header holding the element size, the number of elements and
+ * the capacity, followed by the raw array. open() maps an existing file as it is, so
+ * reopening a list costs the same whatever its size, and the elements are paged in from the
+ * page cache on first access. Growth doubles the capacity by extending the file and mapping
+ * it again. Changes reach the file when the kernel writes the pages back, or at once on
+ * sync().
+ *
+ * Only trivially copyable T can be stored. A failing system call throws std::runtime_error.
+ *
+ * The iterator iterates in the order of the elements being loaded into this list
+ */
+template <class T>
+class MappedArrayList
+{
+    static_assert(std::is_trivially_copyable<T>::value, "MappedArrayList needs trivially copyable elements");
+
+    struct Header{
+        char magic[8];
+        unsigned int elemSize, reserved;
+        long long rear, Size;
+    };
+    static const int HeaderSize = 64;
+    static_assert(sizeof(Header) <= HeaderSize && alignof(T) <= HeaderSize, "element alignment too large");
+
+    int fd;
+    size_t len;
+    char *base;
+    Header *head;
+    T *elem;
+
+    static void fail(const char *what) {throw std::runtime_error(std::string("\nMappedArrayList: ") + what + " failed\n");}
+
+    static size_t bytes(long long n) {return HeaderSize + sizeof(T) * n;}
+
+    void map(long long n) {
+        void *p = mmap(NULL, bytes(n), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED) fail("mmap");
+        len = bytes(n);
+        base = static_cast<char *>(p);
+        head = reinterpret_cast<Header *>(base);
+        elem = reinterpret_cast<T *>(base + HeaderSize);
+    }
+    void unmap() {
+        if (base != NULL) munmap(base, len);
+        base = NULL; head = NULL; elem = NULL;
+    }
+
+    void reallocate(long long newSize) {
+        long long oldSize = head->Size;
+        unmap();
+        if (ftruncate(fd, bytes(newSize)) != 0) {map(oldSize); fail("ftruncate");}
+        map(newSize);
+        head->Size = newSize;
+    }
+
+    void doubleSpace() {
+        long long initSize = (4096 - HeaderSize) / (long long)sizeof(T);
+        reallocate(head->Size ? 2 * head->Size : (initSize > 0 ? initSize : 1));
+    }
+
+    void check() const {if (base == NULL) throw std::runtime_error("\nMappedArrayList: no file is open\n");}
+
+    MappedArrayList(const MappedArrayList &);
+    MappedArrayList &operator=(const MappedArrayList &);
+public:
+    class Iterator
+    {
+        int pos, last;
+        MappedArrayList *arr;
+    public:
+        void init(MappedArrayList *_a){pos = 0; last = -1; arr = _a;}
+        /**
+         * Returns true if the iteration has more elements.
+         */
+        bool hasNext() {return pos < arr->size();}
+
+        /**
+         * Returns the next element in the iteration.
+         * @throw ElementNotExist exception when hasNext() == false
+         */
+        const T &next() {
+            if (!hasNext()) throw ElementNotExist("\nNo Such Element\n");
+            last = pos; pos ++; return arr->get(last);
+        }
+
+        /**
+         * Removes from the underlying collection the last element
+         * returned by the iterator
+         * @throw ElementNotExist
+         */
+        void remove() {
+            if (last < 0) throw ElementNotExist("\nNo Such Element\n");
+            arr->removeIndex(last);
+            pos --; last = -1;
+        }
+    };
+
+    /**
+     * Constructs a list with no file behind it, open() has to be called before use.
+     */
+    MappedArrayList() {fd = -1; len = 0; base = NULL; head = NULL; elem = NULL;}
+
+    /**
+     * Constructs a list backed by the file at path, see open().
+     */
+    explicit MappedArrayList(const char *path) {
+        fd = -1; len = 0; base = NULL; head = NULL; elem = NULL;
+        open(path);
+    }
+
+    /**
+     * Destructor, unmaps the file. Pages not yet written back are kept by the page cache.
+     */
+    ~MappedArrayList() {close();}
+
+    /**
+     * Maps the file at path, creating an empty list if it does not exist. An existing file is
+     * used in place without reading its elements.
+     */
+    void open(const char *path) {
+        close();
+        fd = ::open(path, O_RDWR | O_CREAT, 0644);
+        if (fd < 0) fail("open");
+        struct stat st;
+        if (fstat(fd, &st) != 0) {close(); fail("fstat");}
+        if (st.st_size == 0) {
+            if (ftruncate(fd, bytes(0)) != 0) {close(); fail("ftruncate");}
+            map(0);
+            std::memcpy(head->magic, "DSMAPARR", 8);
+            head->elemSize = sizeof(T); head->reserved = 0;
+            head->rear = head->Size = 0;
+            return;
+        }
+        if (st.st_size < HeaderSize) {close(); fail("header check");}
+        map(0);
+        Header h = *head;
+        unmap();
+        //the capacity must fit in the file and the size in the capacity, or add() and get()
+        //would reach past the mapping
+        if (std::memcmp(h.magic, "DSMAPARR", 8) != 0 || h.elemSize != sizeof(T)
+                || 0 > h.Size || h.Size > (long long)((st.st_size - HeaderSize) / sizeof(T)) || h.Size > INT_MAX
+                || 0 > h.rear || h.rear > h.Size)
+            {close(); fail("header check");}
+        map(h.Size);
+    }
+
+    /**
+     * Unmaps and closes the file, if one is open.
+     */
+    void close() {
+        unmap();
+        if (fd >= 0) ::close(fd);
+        fd = -1;
+    }
+
+    /**
+     * Returns true if a file is mapped.
+     */
+    bool isOpen() const {return base != NULL;}
+
+    /**
+     * Writes the mapped pages back to the file and waits for the write to finish.
+     */
+    void sync() {
+        check();
+        if (msync(base, len, MS_SYNC) != 0) fail("msync");
+    }
+
+    /**
+     * Appends the specified element to the end of this list.
+     */
+    bool add(const T& e) {
+        check();
+        T tmp = e; //e may refer into the mapping
+        if (head->rear == head->Size) doubleSpace();
+        elem[head->rear++] = tmp;
+        return true;
+    }
+
+    /**
+     * Inserts the specified element to the specified position in this list.
+     * The range of index parameter is [0, size].
+     * @throw IndexOutOfBound
+     */
+    void add(int index, const T& element) {
+        check();
+        if (index > head->rear || index < 0) throw IndexOutOfBound("\nIllegal Segment\n");
+        T tmp = element;
+        if (head->rear == head->Size) doubleSpace();
+        std::memmove(elem + index + 1, elem + index, sizeof(T) * (head->rear - index));
+        elem[index] = tmp; head->rear ++;
+    }
+
+    /**
+     * Removes all of the elements from this list. The file keeps its capacity.
+     */
+    void clear() {check(); head->rear = 0;}
+
+    /**
+     * Makes sure that at least n elements fit without further growth.
+     */
+    void reserve(int n) {check(); if (n > head->Size) reallocate(n);}
+
+    /**
+     * Returns the number of elements the file can hold without growing.
+     */
+    int capacity() const {return base == NULL ? 0 : head->Size;}
+
+    /**
+     * Returns true if this list contains the specified element.
+     */
+    bool contains(const T& e) const {return indexOf(e) != -1;}
+
+    /**
+     * Returns the index of the first occurrence of the specified element, or -1 if there is none.
+     */
+    int indexOf(const T& e) const {return SimdSearch<T>::indexOf(elem, size(), e);}
+
+    /**
+     * Returns a const reference to the element at the specified position in this list.
+     * The reference is invalidated when the list grows.
+     * @throw IndexOutOfBound
+     */
+    const T& get(int index) const {
+        if (index >= size() || index < 0) throw IndexOutOfBound("\nIllegal Segment\n");
+        return elem[index];
+    }
+
+    /**
+     * Returns true if this list contains no elements.
+     */
+    bool isEmpty() const {return size() == 0;}
+
+    /**
+     * Removes the element at the specified position in this list.
+     * @throw IndexOutOfBound
+     */
+    void removeIndex(int index) {
+        if (index >= size() || index < 0) throw IndexOutOfBound("\nIllegal Segment\n");
+        std::memmove(elem + index, elem + index + 1, sizeof(T) * (head->rear - index - 1));
+        head->rear --;
+    }
+
+    /**
+     * Removes the first occurrence of the specified element from this list, if it is present.
+     * Returns true if it is present in the list, otherwise false.
+     */
+    bool remove(const T &e) {
+        int i = indexOf(e);
+        if (i == -1) return false;
+        removeIndex(i);
+        return true;
+    }
+
+    /**
+     * Replaces the element at the specified position in this list with the specified element.
+     * @throw IndexOutOfBound
+     */
+    void set(int index, const T &element) {
+        if (index < 0 || index >= size()) throw IndexOutOfBound("\nIllegal Segment\n");
+        elem[index] = element;
+    }
+
+    /**
+     * Returns the number of elements in this list.
+     */
+    int size() const {return base == NULL ? 0 : head->rear;}
+
+    /**
+     * Returns an iterator over the elements in this list.
+     */
+    Iterator iterator() {
+        Iterator itr;
+        itr.init(this);
+        return itr;
+    }
+};
+
+#endif
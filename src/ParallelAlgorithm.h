@@ -0,0 +1,204 @@
+/** @file */
+#ifndef __PARALLELALGORITHM_H
+#define __PARALLELALGORITHM_H
+
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+/**
+ * Parallel kernels over a contiguous array, run on ThreadPool::instance().
+ * They back ArrayList::sort, parallelForEach and parallelReduce.
+ *
+ * Work is cut into chunks of about chunkBytes so that each task streams through a
+ * cache-resident block.
+ */
+struct ParallelAlgorithm
+{
+    static const int chunkBytes = 1 << 16;
+    //below this many elements a sort or merge runs sequentially
+    static const int sortCutoff = 1 << 13;
+
+    template <class T>
+    static int chunkSize() {return sizeof(T) >= chunkBytes ? 1 : chunkBytes / sizeof(T);}
+
+    /**
+     * Calls fn on every element of a[0, n).
+     */
+    template <class T, class F>
+    static void forEach(T *a, int n, F &fn) {
+        int c = chunkSize<T>();
+        if (n <= c) {for (int i = 0; i < n; i ++) fn(a[i]); return;}
+        TaskGroup g;
+        for (int lo = 0; lo < n; lo += c) {
+            int hi = std::min(n, lo + c);
+            g.run([a, lo, hi, &fn]{for (int i = lo; i < hi; i ++) fn(a[i]);});
+        }
+        g.wait();
+    }
+
+    /**
+     * Folds a[0, n) into init with the associative op. Every chunk is folded starting from
+     * its first element, then the partial results are folded into init from left to right.
+     */
+    template <class T, class R, class Op>
+    static R reduce(const T *a, int n, R init, Op &op) {
+        int c = chunkSize<T>();
+        if (n <= c) {for (int i = 0; i < n; i ++) init = op(init, a[i]); return init;}
+        int m = (n + c - 1) / c;
+        std::vector<std::unique_ptr<R> > part(m);
+        TaskGroup g;
+        for (int k = 0; k < m; k ++) {
+            int lo = k * c, hi = std::min(n, lo + c);
+            std::unique_ptr<R> *out = &part[k];
+            g.run([a, lo, hi, out, &op]{
+                R acc(a[lo]);
+                for (int i = lo + 1; i < hi; i ++) acc = op(acc, a[i]);
+                out->reset(new R(std::move(acc)));
+            });
+        }
+        g.wait();
+        for (int k = 0; k < m; k ++) init = op(init, *part[k]);
+        return init;
+    }
+
+    //stable merge of x[0, nx) and y[0, ny) into out, elements are moved
+    template <class T, class Cmp>
+    static void merge(T *x, int nx, T *y, int ny, T *out, Cmp &cmp) {
+        if (nx + ny <= sortCutoff) {
+            std::merge(std::make_move_iterator(x), std::make_move_iterator(x + nx),
+                       std::make_move_iterator(y), std::make_move_iterator(y + ny), out, cmp);
+            return;
+        }
+        int mx, my;
+        if (nx >= ny) {
+            mx = nx / 2;
+            my = std::lower_bound(y, y + ny, x[mx], cmp) - y;
+        } else {
+            my = ny / 2;
+            mx = std::upper_bound(x, x + nx, y[my], cmp) - x;
+        }
+        TaskGroup g;
+        g.run([=, &cmp]{merge(x, mx, y, my, out, cmp);});
+        merge(x + mx, nx - mx, y + my, ny - my, out + mx + my, cmp);
+        g.wait();
+    }
+
+    //sorts a[0, n), the result ends up in b if toB and in a otherwise
+    template <class T, class Cmp>
+    static void mergeSort(T *a, T *b, int n, bool toB, Cmp &cmp) {
+        if (n <= sortCutoff) {
+            std::stable_sort(a, a + n, cmp);
+            if (toB) std::move(a, a + n, b);
+            return;
+        }
+        int h = n / 2;
+        TaskGroup g;
+        g.run([=, &cmp]{mergeSort(a, b, h, !toB, cmp);});
+        mergeSort(a + h, b + h, n - h, !toB, cmp);
+        g.wait();
+        if (toB) merge(a, h, a + h, n - h, b, cmp);
+            else merge(b, h, b + h, n - h, a, cmp);
+    }
+
+    /**
+     * Stable parallel merge sort of a[0, n).
+     */
+    template <class T, class Cmp>
+    static void sort(T *a, int n, Cmp &cmp) {
+        if (n <= sortCutoff) {std::stable_sort(a, a + n, cmp); return;}
+        T *buf = static_cast<T *>(::operator new(sizeof(T) * n));
+        std::uninitialized_copy(std::make_move_iterator(a), std::make_move_iterator(a + n), buf);
+        mergeSort(buf, a, n, true, cmp);
+        for (int i = 0; i < n; i ++) buf[i].~T();
+        ::operator delete(buf);
+    }
+
+    /**
+     * RadixKey<T>::key maps an arithmetic value to an unsigned integer with the same order.
+     */
+    template <class T, bool Float = std::is_floating_point<T>::value>
+    struct RadixKey
+    {
+        typedef typename std::make_unsigned<typename std::conditional<
+            std::is_same<T, bool>::value, unsigned char, T>::type>::type U;
+        static U key(T v) {
+            U u = static_cast<U>(v);
+            if (std::is_signed<T>::value) u ^= U(1) << (sizeof(U) * 8 - 1);
+            return u;
+        }
+    };
+    template <class T>
+    struct RadixKey<T, true>
+    {
+        typedef typename std::conditional<sizeof(T) == 4, unsigned int, unsigned long long>::type U;
+        static U key(T v) {
+            U u;
+            std::memcpy(&u, &v, sizeof(U));
+            return (u >> (sizeof(U) * 8 - 1)) ? ~u : u | (U(1) << (sizeof(U) * 8 - 1));
+        }
+    };
+
+    /**
+     * True if radixSort() handles T: integral types, and floating point types of 4 or 8
+     * bytes. Others, such as an 80-bit long double, have no radix key of their size.
+     */
+    template <class T>
+    struct Radixable: std::integral_constant<bool, std::is_integral<T>::value
+        || (std::is_floating_point<T>::value && (sizeof(T) == 4 || sizeof(T) == 8))> {};
+
+    /**
+     * Parallel LSD radix sort of the arithmetic array a[0, n), one byte per pass.
+     * Every pass counts the digits of each chunk in parallel and then scatters the chunks
+     * in parallel to their precomputed offsets. Passes whose digit is the same for every
+     * element are skipped.
+     */
+    template <class T>
+    static void radixSort(T *a, int n) {
+        typedef RadixKey<T> RK;
+        static_assert(sizeof(typename RK::U) == sizeof(T), "unsupported arithmetic type");
+        if (n <= 1) return;
+        int c = std::max(chunkSize<T>(), (n + 4 * ThreadPool::instance().size() - 1) / (4 * ThreadPool::instance().size()));
+        int m = (n + c - 1) / c;
+        std::unique_ptr<T[]> tmp(new T[n]);
+        std::vector<int> cnt(m * 256);
+        T *src = a, *dst = tmp.get();
+        for (int pass = 0; pass < (int)sizeof(T); pass ++) {
+            int shift = pass * 8;
+            std::fill(cnt.begin(), cnt.end(), 0);
+            {
+                TaskGroup g;
+                for (int k = 0; k < m; k ++)
+                    g.run([=, &cnt]{
+                        int *h = &cnt[k * 256];
+                        for (int i = k * c, hi = std::min(n, i + c); i < hi; i ++) h[(RK::key(src[i]) >> shift) & 255] ++;
+                    });
+            }
+            bool trivial = false;
+            int sum = 0;
+            for (int d = 0; d < 256 && !trivial; d ++) {
+                int tot = 0;
+                for (int k = 0; k < m; k ++) {int x = cnt[k * 256 + d]; cnt[k * 256 + d] = sum + tot; tot += x;}
+                if (tot == n) trivial = true;
+                sum += tot;
+            }
+            if (trivial) continue;
+            {
+                TaskGroup g;
+                for (int k = 0; k < m; k ++)
+                    g.run([=, &cnt]{
+                        int *o = &cnt[k * 256];
+                        for (int i = k * c, hi = std::min(n, i + c); i < hi; i ++) dst[o[(RK::key(src[i]) >> shift) & 255] ++] = src[i];
+                    });
+            }
+            std::swap(src, dst);
+        }
+        if (src != a) std::memcpy(a, src, sizeof(T) * n);
+    }
+};
+
+#endif
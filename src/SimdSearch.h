@@ -0,0 +1,230 @@
+/** @file */
+#ifndef __SIMDSEARCH_H
+#define __SIMDSEARCH_H
+
+#include <type_traits>
+
+#if defined(__GNUC__) && defined(__AVX2__)
+#include <immintrin.h>
+#define __SIMDSEARCH_AVX2
+#elif defined(__GNUC__) && defined(__SSE2__)
+#include <emmintrin.h>
+#ifdef __SSE4_1__
+#include <smmintrin.h>
+#endif
+#define __SIMDSEARCH_SSE2
+#endif
+
+/**
+ * Linear search kernels behind ArrayList::indexOf, lastIndexOf and count.
+ *
+ * For arithmetic T the kernels compare a whole vector register of elements at a time, using
+ * AVX2 or SSE2 as selected at compile time (e.g. by -mavx2 or -march=native). Every other T
+ * goes through the plain operator== loop. Floating point lanes are compared with ordered
+ * equality, so NaN never matches and 0.0 matches -0.0, exactly as operator== does.
+ */
+
+/**
+ * SimdLane<Bytes, Float> describes how to compare elements of the given size and kind one
+ * register at a time. eq() returns the movemask of the byte lanes, so an element matching at
+ * position i sets bits [i * Bytes, (i + 1) * Bytes).
+ * type is void when no kernel exists for the combination on this target.
+ */
+template <int Bytes, bool Float>
+struct SimdLane
+{
+    typedef void type;
+};
+
+#ifdef __SIMDSEARCH_AVX2
+struct SimdLaneBase
+{
+    typedef __m256i vec;
+    static const int width = 32;
+    static vec load(const void *p) {return _mm256_loadu_si256(static_cast<const __m256i *>(p));}
+    static unsigned mask(vec x) {return static_cast<unsigned>(_mm256_movemask_epi8(x));}
+};
+template <> struct SimdLane<1, false> : SimdLaneBase
+{
+    typedef SimdLane type;
+    template <class T> static vec splat(T v) {return _mm256_set1_epi8(static_cast<char>(v));}
+    static unsigned eq(const void *p, vec k) {return mask(_mm256_cmpeq_epi8(load(p), k));}
+};
+template <> struct SimdLane<2, false> : SimdLaneBase
+{
+    typedef SimdLane type;
+    template <class T> static vec splat(T v) {return _mm256_set1_epi16(static_cast<short>(v));}
+    static unsigned eq(const void *p, vec k) {return mask(_mm256_cmpeq_epi16(load(p), k));}
+};
+template <> struct SimdLane<4, false> : SimdLaneBase
+{
+    typedef SimdLane type;
+    template <class T> static vec splat(T v) {return _mm256_set1_epi32(static_cast<int>(v));}
+    static unsigned eq(const void *p, vec k) {return mask(_mm256_cmpeq_epi32(load(p), k));}
+};
+template <> struct SimdLane<8, false> : SimdLaneBase
+{
+    typedef SimdLane type;
+    template <class T> static vec splat(T v) {return _mm256_set1_epi64x(static_cast<long long>(v));}
+    static unsigned eq(const void *p, vec k) {return mask(_mm256_cmpeq_epi64(load(p), k));}
+};
+template <> struct SimdLane<4, true> : SimdLaneBase
+{
+    typedef SimdLane type;
+    template <class T> static vec splat(T v) {return _mm256_castps_si256(_mm256_set1_ps(v));}
+    static unsigned eq(const void *p, vec k) {
+        __m256 x = _mm256_loadu_ps(static_cast<const float *>(p));
+        return mask(_mm256_castps_si256(_mm256_cmp_ps(x, _mm256_castsi256_ps(k), _CMP_EQ_OQ)));
+    }
+};
+template <> struct SimdLane<8, true> : SimdLaneBase
+{
+    typedef SimdLane type;
+    template <class T> static vec splat(T v) {return _mm256_castpd_si256(_mm256_set1_pd(v));}
+    static unsigned eq(const void *p, vec k) {
+        __m256d x = _mm256_loadu_pd(static_cast<const double *>(p));
+        return mask(_mm256_castpd_si256(_mm256_cmp_pd(x, _mm256_castsi256_pd(k), _CMP_EQ_OQ)));
+    }
+};
+#endif
+
+#ifdef __SIMDSEARCH_SSE2
+struct SimdLaneBase
+{
+    typedef __m128i vec;
+    static const int width = 16;
+    static vec load(const void *p) {return _mm_loadu_si128(static_cast<const __m128i *>(p));}
+    static unsigned mask(vec x) {return static_cast<unsigned>(_mm_movemask_epi8(x));}
+};
+template <> struct SimdLane<1, false> : SimdLaneBase
+{
+    typedef SimdLane type;
+    template <class T> static vec splat(T v) {return _mm_set1_epi8(static_cast<char>(v));}
+    static unsigned eq(const void *p, vec k) {return mask(_mm_cmpeq_epi8(load(p), k));}
+};
+template <> struct SimdLane<2, false> : SimdLaneBase
+{
+    typedef SimdLane type;
+    template <class T> static vec splat(T v) {return _mm_set1_epi16(static_cast<short>(v));}
+    static unsigned eq(const void *p, vec k) {return mask(_mm_cmpeq_epi16(load(p), k));}
+};
+template <> struct SimdLane<4, false> : SimdLaneBase
+{
+    typedef SimdLane type;
+    template <class T> static vec splat(T v) {return _mm_set1_epi32(static_cast<int>(v));}
+    static unsigned eq(const void *p, vec k) {return mask(_mm_cmpeq_epi32(load(p), k));}
+};
+#ifdef __SSE4_1__
+template <> struct SimdLane<8, false> : SimdLaneBase
+{
+    typedef SimdLane type;
+    template <class T> static vec splat(T v) {return _mm_set1_epi64x(static_cast<long long>(v));}
+    static unsigned eq(const void *p, vec k) {return mask(_mm_cmpeq_epi64(load(p), k));}
+};
+#endif
+template <> struct SimdLane<4, true> : SimdLaneBase
+{
+    typedef SimdLane type;
+    template <class T> static vec splat(T v) {return _mm_castps_si128(_mm_set1_ps(v));}
+    static unsigned eq(const void *p, vec k) {
+        __m128 x = _mm_loadu_ps(static_cast<const float *>(p));
+        return mask(_mm_castps_si128(_mm_cmpeq_ps(x, _mm_castsi128_ps(k))));
+    }
+};
+template <> struct SimdLane<8, true> : SimdLaneBase
+{
+    typedef SimdLane type;
+    template <class T> static vec splat(T v) {return _mm_castpd_si128(_mm_set1_pd(v));}
+    static unsigned eq(const void *p, vec k) {
+        __m128d x = _mm_loadu_pd(static_cast<const double *>(p));
+        return mask(_mm_castpd_si128(_mm_cmpeq_pd(x, _mm_castsi128_pd(k))));
+    }
+};
+#endif
+
+template <class T, bool Arith = std::is_arithmetic<T>::value>
+struct SimdLaneFor
+{
+    typedef void type;
+};
+template <class T>
+struct SimdLaneFor<T, true>
+{
+    typedef typename SimdLane<sizeof(T), std::is_floating_point<T>::value>::type type;
+};
+
+/**
+ * Vectorized kernels, L is the SimdLane to compare with.
+ */
+template <class T, class L>
+struct SimdSearchImpl
+{
+    static const int W = L::width / sizeof(T);
+
+    static int indexOf(const T *p, int n, T v) {
+        typename L::vec k = L::template splat<T>(v);
+        int i = 0;
+        for (; i + W <= n; i += W) {
+            unsigned m = L::eq(p + i, k);
+            if (m) return i + __builtin_ctz(m) / sizeof(T);
+        }
+        for (; i < n; i ++) if (p[i] == v) return i;
+        return -1;
+    }
+
+    static int lastIndexOf(const T *p, int n, T v) {
+        typename L::vec k = L::template splat<T>(v);
+        int i = n;
+        for (; i > n - n % W; i --) if (p[i - 1] == v) return i - 1;
+        for (; i > 0; i -= W) {
+            unsigned m = L::eq(p + i - W, k);
+            if (m) return i - W + (31 - __builtin_clz(m)) / sizeof(T);
+        }
+        return -1;
+    }
+
+    //__builtin_popcount is a library call unless the target has POPCNT
+    static int bitCount(unsigned m) {
+#ifdef __POPCNT__
+        return __builtin_popcount(m);
+#else
+        m = m - ((m >> 1) & 0x55555555u);
+        m = (m & 0x33333333u) + ((m >> 2) & 0x33333333u);
+        return static_cast<int>((((m + (m >> 4)) & 0x0F0F0F0Fu) * 0x01010101u) >> 24);
+#endif
+    }
+
+    static int count(const T *p, int n, T v) {
+        typename L::vec k = L::template splat<T>(v);
+        int i = 0, res = 0;
+        for (; i + W <= n; i += W) res += bitCount(L::eq(p + i, k)) / sizeof(T);
+        for (; i < n; i ++) if (p[i] == v) res ++;
+        return res;
+    }
+};
+
+/**
+ * Fallback kernels for types without a vector comparison.
+ */
+template <class T>
+struct SimdSearchImpl<T, void>
+{
+    static int indexOf(const T *p, int n, const T &v) {
+        for (int i = 0; i < n; i ++) if (p[i] == v) return i;
+        return -1;
+    }
+    static int lastIndexOf(const T *p, int n, const T &v) {
+        for (int i = n - 1; i >= 0; i --) if (p[i] == v) return i;
+        return -1;
+    }
+    static int count(const T *p, int n, const T &v) {
+        int res = 0;
+        for (int i = 0; i < n; i ++) if (p[i] == v) res ++;
+        return res;
+    }
+};
+
+template <class T>
+struct SimdSearch : SimdSearchImpl<T, typename SimdLaneFor<T>::type> {};
+
+#endif
@@ -0,0 +1,67 @@
+/** @file */
+#ifndef __SMALLARRAYLIST_H
+#define __SMALLARRAYLIST_H
+
+#include "ArrayList.h"
+#include <type_traits>
+#include <utility>
+
+/**
+ * SmallArrayList is an ArrayList that keeps up to N elements in a buffer inside the object
+ * itself, and only moves them to the heap once it grows past N.
+ *
+ * An empty or short list therefore never allocates, and clear() returns to the inline
+ * buffer without allocating either. The API and the iterator are those of ArrayList, and a
+ * SmallArrayList can be passed wherever an ArrayList<T, A> & is expected.
+ */
+template <class T, int N, class A = HeapAllocator>
+class SmallArrayList : public ArrayList<T, A>
+{
+    static_assert(N > 0, "SmallArrayList needs an inline capacity");
+
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type buf[N];
+
+    T *inlineBuffer() {return reinterpret_cast<T *>(buf);}
+public:
+    /**
+     * Constructs an empty list on the inline buffer.
+     */
+    SmallArrayList(): ArrayList<T, A>(inlineBuffer(), N, A()) {}
+
+    /**
+     * Constructs an empty list on the inline buffer, spilling to memory from the allocator a.
+     */
+    explicit SmallArrayList(const A &a): ArrayList<T, A>(inlineBuffer(), N, a) {}
+
+    /**
+     * Copy-constructor
+     */
+    SmallArrayList(const SmallArrayList &x): ArrayList<T, A>(inlineBuffer(), N, x.getAllocator()) {ArrayList<T, A>::operator=(x);}
+
+    /**
+     * Copies an ArrayList of any kind.
+     */
+    SmallArrayList(const ArrayList<T, A> &x): ArrayList<T, A>(inlineBuffer(), N, x.getAllocator()) {ArrayList<T, A>::operator=(x);}
+
+    /**
+     * Move-constructor. A heap buffer of x is taken over, inline elements are moved one by one.
+     */
+    SmallArrayList(SmallArrayList &&x): ArrayList<T, A>(inlineBuffer(), N, x.getAllocator()) {ArrayList<T, A>::operator=(std::move(x));}
+
+    /**
+     * Moves from an ArrayList of any kind.
+     */
+    SmallArrayList(ArrayList<T, A> &&x): ArrayList<T, A>(inlineBuffer(), N, x.getAllocator()) {ArrayList<T, A>::operator=(std::move(x));}
+
+    /**
+     * Assignment operator
+     */
+    SmallArrayList &operator=(const SmallArrayList &x) {ArrayList<T, A>::operator=(x); return *this;}
+
+    /**
+     * Move assignment operator
+     */
+    SmallArrayList &operator=(SmallArrayList &&x) {ArrayList<T, A>::operator=(std::move(x)); return *this;}
+};
+
+#endif
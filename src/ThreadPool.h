@@ -0,0 +1,168 @@
+/** @file */
+#ifndef __THREADPOOL_H
+#define __THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * A work-stealing thread pool.
+ *
+ * Every worker owns a deque of tasks. A worker pushes and pops its own tasks at the back,
+ * and when it runs dry it steals from the front of the other workers' deques, so the big
+ * tasks that were split off first are the ones that migrate. Tasks submitted from outside
+ * the pool are dealt round robin.
+ *
+ * Tasks must not throw. Programs using the pool have to be linked with -pthread.
+ */
+class ThreadPool
+{
+    struct Worker{
+        std::deque<std::function<void()> > q;
+        std::mutex lock;
+    };
+    std::vector<std::unique_ptr<Worker> > workers;
+    std::vector<std::thread> threads;
+    std::atomic<bool> stop;
+    //the number of queued tasks. It only goes up, and stop is only set, under sleepLock,
+    //so that a worker cannot miss the notify between checking them and going to sleep
+    std::atomic<int> pending;
+    std::atomic<unsigned> next;
+    std::mutex sleepLock;
+    std::condition_variable wake;
+
+    struct Current{
+        ThreadPool *pool;
+        int idx;
+    };
+    static Current &current() {
+        static thread_local Current cur = {NULL, -1};
+        return cur;
+    }
+
+    bool pop(int idx, bool back, std::function<void()> &task) {
+        Worker &w = *workers[idx];
+        std::lock_guard<std::mutex> guard(w.lock);
+        if (w.q.empty()) return false;
+        if (back) {task = std::move(w.q.back()); w.q.pop_back();}
+            else {task = std::move(w.q.front()); w.q.pop_front();}
+        pending --;
+        return true;
+    }
+
+    void loop(int idx) {
+        current().pool = this; current().idx = idx;
+        while (!stop) {
+            if (runOne()) continue;
+            std::unique_lock<std::mutex> lk(sleepLock);
+            wake.wait(lk, [this]{return stop || pending > 0;});
+        }
+    }
+
+public:
+    /**
+     * Starts a pool with the given number of worker threads, one per hardware thread by default.
+     */
+    explicit ThreadPool(int n = 0): stop(false), pending(0), next(0) {
+        if (n <= 0) n = std::thread::hardware_concurrency();
+        if (n <= 0) n = 1;
+        for (int i = 0; i < n; i ++) workers.push_back(std::unique_ptr<Worker>(new Worker));
+        for (int i = 0; i < n; i ++) threads.push_back(std::thread(&ThreadPool::loop, this, i));
+    }
+
+    /**
+     * Runs the tasks left in the queues, then joins the workers.
+     */
+    ~ThreadPool() {
+        while (runOne()) {}
+        {
+            std::lock_guard<std::mutex> guard(sleepLock);
+            stop = true;
+        }
+        wake.notify_all();
+        for (size_t i = 0; i < threads.size(); i ++) threads[i].join();
+    }
+
+    /**
+     * Returns the number of worker threads.
+     */
+    int size() const {return workers.size();}
+
+    /**
+     * Queues a task.
+     */
+    void submit(std::function<void()> task) {
+        int idx = current().pool == this ? current().idx : next++ % workers.size();
+        {
+            std::lock_guard<std::mutex> guard(workers[idx]->lock);
+            workers[idx]->q.push_back(std::move(task));
+        }
+        {
+            std::lock_guard<std::mutex> guard(sleepLock);
+            pending ++;
+        }
+        wake.notify_one();
+    }
+
+    /**
+     * Runs one queued task on the calling thread, preferring the caller's own deque.
+     * Returns false if every deque was empty.
+     */
+    bool runOne() {
+        std::function<void()> task;
+        int n = workers.size(), self = current().pool == this ? current().idx : -1;
+        if (self >= 0 && pop(self, true, task)) {task(); return true;}
+        for (int i = 1; i <= n; i ++)
+            if (pop((self + i + n) % n, false, task)) {task(); return true;}
+        return false;
+    }
+
+    /**
+     * Returns the process-wide pool used by the parallel container algorithms.
+     */
+    static ThreadPool &instance() {
+        static ThreadPool pool;
+        return pool;
+    }
+};
+
+/**
+ * A set of tasks that can be waited for together. The waiting thread runs queued tasks
+ * itself instead of blocking, so groups may be nested freely.
+ */
+class TaskGroup
+{
+    ThreadPool &pool;
+    std::atomic<int> left;
+
+    TaskGroup(const TaskGroup &);
+    TaskGroup &operator=(const TaskGroup &);
+public:
+    explicit TaskGroup(ThreadPool &_p = ThreadPool::instance()): pool(_p), left(0) {}
+    ~TaskGroup() {wait();}
+
+    /**
+     * Runs f on the pool as part of this group.
+     */
+    template <class F>
+    void run(F f) {
+        left ++;
+        pool.submit([this, f]() mutable {f(); left --;});
+    }
+
+    /**
+     * Returns once every task of this group has finished.
+     */
+    void wait() {
+        while (left > 0)
+            if (!pool.runOne()) std::this_thread::yield();
+    }
+};
+
+#endif
@@ -3,12 +3,30 @@
 #define __TREEMAP_H
 
 #include "ElementNotExist.h"
+#include "Allocator.h"
+#include "BloomFilter.h"
+#include "HashFunctions.h"
+#include <new>
+#include <type_traits>
+#include <utility>
 
 /**
  * TreeMap is the balanced-tree implementation of map. The iterators must
  * iterate through the map in the natural order (operator<) of the key.
+ *
+ * The node array of the treap is allocated from the allocator A, see Allocator.h.
+ *
+ * containsKey(), get() and remove() also accept keys of any non-arithmetic type Q that
+ * compares with K directly through <, > and ==, such as const char * for std::string
+ * keys, so no temporary K is built for the lookup.
+ *
+ * setBloomFilter<H>() adds a BloomFilter over the keys, hashed by H as for HashMap, which
+ * containsKey(), get() and remove() on a K consult before walking down the tree, so that
+ * looking up a missing key mostly costs one cache line. A present key pays for that line
+ * on top of the walk down the tree. Removed keys stay in the filter until it is rebuilt
+ * from the map, which happens whenever more keys were added to it than it is sized for.
  */
-template<class K, class V>
+template<class K, class V, class A = HeapAllocator>
 class TreeMap
 {
 public:
@@ -18,11 +36,7 @@ public:
         V value;
     public:
         Entry(){}
-        Entry(K k, V v)
-        {
-            key = k;
-            value = v;
-        }
+        Entry(const K &k, const V &v): key(k), value(v) {}
         Entry(const Entry& x){
             key = x.key; value = x.value; 
         }
@@ -31,12 +45,12 @@ public:
             return *this;
         }
 
-        K getKey() const
+        const K &getKey() const
         {
             return key;
         }
 
-        V getValue() const
+        const V &getValue() const
         {
             return value;
         }
@@ -57,11 +71,21 @@ public:
         int Size, root, cur_size, tot;
         const static int cap = 1000000; 
         Node *p;
+        A alloc;
+        Node *newArray(int n){
+            Node *q = static_cast<Node *>(alloc.allocate(sizeof(Node) * n));
+            for (int i = 0; i < n; i ++) new (q + i) Node();
+            return q;
+        }
+        void deleteArray(Node *q, int n){
+            for (int i = 0; i < n; i ++) q[i].~Node();
+            alloc.deallocate(q, sizeof(Node) * n);
+        }
         void doubleSpace(){
             Node *tmp = p; 
-            p = new Node[2 * Size];
+            p = newArray(2 * Size);
             for (int i = 0; i < Size; i ++) p[i] = tmp[i];
-            Size *= 2;delete [] tmp;
+            deleteArray(tmp, Size); Size *= 2;
         }
         void update(int x){
             p[x].sum = 1;
@@ -82,7 +106,7 @@ public:
             update(x); update(y);
             x = y;
         }
-        void ins(int &k, Entry cur){
+        void ins(int &k, const Entry &cur){
             if (k == -1){
                 k = ++cur_size; 
                 p[k].l = p[k].r = -1;
@@ -98,10 +122,11 @@ public:
                         if (p[ p[k].r ].fix > p[k].fix) rot_l(k);
                     }
         }
-        void del(int &k, Entry cur){
+        template <class Q>
+        void del(int &k, const Q &cur){
             if (k == -1) return;
-            if (cur.getKey() < p[k].key.getKey()) {del(p[k].l, cur); update(k); return; }
-            if (cur.getKey() > p[k].key.getKey()) {del(p[k].r, cur); update(k); return; }
+            if (cur < p[k].key.getKey()) {del(p[k].l, cur); update(k); return; }
+            if (cur > p[k].key.getKey()) {del(p[k].r, cur); update(k); return; }
                 else {
                             if (p[k].l == -1 && p[k].r == -1) {tot ++; p[k].tag = 0; k = -1;}
                                 else if (p[k].l == -1) {tot ++; p[k].tag = 0; k = p[k].r;}
@@ -111,97 +136,138 @@ public:
                                                      }else{rot_r(k); del(p[k].r, cur); update(k);}
                      }
         }
-        bool K_existed(int k, K key)const{
+        template <class Q>
+        bool K_existed(int k, const Q &key)const{
             if (k == -1) return 0;
             if (p[k].key.getKey() == key) return 1;
             if (key < p[k].key.getKey()) return K_existed(p[k].l, key); else return K_existed(p[k].r, key);
         }
-        bool V_existed(int k, V val)const{
+        bool V_existed(int k, const V &val)const{
             if (k == -1) return 0;
             if (p[k].key.getValue() == val) return 1;
             return V_existed(p[k].l, val) | V_existed(p[k].r, val);
         }
-        V &K_Val(int k, K key) const{
-            if (p[k].key.getKey() == key) return p[k].key.getValue2();
+        template <class Q>
+        V *K_Val(int k, const Q &key) const{
+            if (k == -1) return NULL;
+            if (p[k].key.getKey() == key) return &p[k].key.getValue2();
             if (key < p[k].key.getKey()) return K_Val(p[k].l, key); else return K_Val(p[k].r, key);
         }
-        Entry &Get(int k, int x){
+        const Entry &Get(int k, int x) const{
             int tmpx = x;
             if (p[k].l != -1) x -= p[ p[k].l ].sum;
             if (x == 1) return p[k].key;
             if (x <= 0) return Get(p[k].l, tmpx); else return Get(p[k].r, x - 1);
         }
-        treap(){
+        treap(const A &a = A()): alloc(a){
             srand(time(0));
             cur_size = -1;
             root = -1;
             tot = 0;
-            Size = 1; p = new Node[Size];
+            Size = 1; p = newArray(Size);
         }
-        treap(const treap &x){
-            Size = x.Size; root = x.root; cur_size = x.cur_size;
-            p = new Node[Size];
+        treap(const treap &x): alloc(x.alloc){
+            Size = x.Size; root = x.root; cur_size = x.cur_size; tot = x.tot;
+            p = newArray(Size);
             for (int i = 0; i < Size; i ++) p[i] = x.p[i];
         }
 
         void clear(){
+            deleteArray(p, Size);
             srand(time(0));
             cur_size = -1;
             root = -1;
             tot = 0;
-            Size = 1; p = new Node[Size];
+            Size = 1; p = newArray(Size);
         }
-        ~treap(){delete [] p;}
+        ~treap(){deleteArray(p, Size);}
         treap &operator=(const treap &x){
-            delete [] p;
-            Size = x.Size; root = x.root; cur_size = x.cur_size;
-            p = new Node[Size];
+            if (&x == this) return *this;
+            deleteArray(p, Size);
+            Size = x.Size; root = x.root; cur_size = x.cur_size; tot = x.tot;
+            p = newArray(Size);
             for (int i = 0; i < Size; i ++) p[i] = x.p[i];
             return *this;
         }
-        void insert(Entry cur){
+        void insert(const Entry &cur){
             if (cur_size + 1 >= Size) doubleSpace();
             ins(root, cur);
         } 
         void refresh(){
             Node *tmp = p;
-            int preS = cur_size;
+            int preS = cur_size, preSize = Size;
             Size = 1; root = -1; cur_size = -1; tot = 0;
-            p = new Node[Size]; 
+            p = newArray(Size); 
             for (int i = 0; i <= preS; i ++) 
                 if (tmp[i].tag) {
                    if (cur_size + 1 >= Size) doubleSpace();ins(root, tmp[i].key); 
                 }
-            delete [] tmp;
+            deleteArray(tmp, preSize);
         }
-        void remove(Entry cur){
+        template <class Q>
+        void remove(const Q &cur){
             del(root, cur); 
             if (tot >= cap) {tot = 0; refresh();}
         }
         int size() const{if (root == -1) return 0; else return p[root].sum;}
-        bool FindKey(K key) const{ return K_existed(root, key);}
-        bool FindValue(V val) const{ return V_existed(root, val);}
-        V &KeyValue(K key) const {return K_Val(root, key);} 
-        Entry &pos(int x){return Get(root, x);}
+        template <class Q>
+        bool FindKey(const Q &key) const{ return K_existed(root, key);}
+        bool FindValue(const V &val) const{ return V_existed(root, val);}
+        template <class Q>
+        V *KeyValue(const Q &key) const {return K_Val(root, key);} 
+        const Entry &pos(int x) const{return Get(root, x);}
         V TT(K key){}
     }T;
     V res;
+    //NULL unless a bloom filter is set, and the hash function it was set with
+    BloomFilter<A> *bloom;
+    unsigned long long (*bloomHash)(const K &);
+
+    //false if the bloom filter rules key out
+    bool mayContain(const K &key) const {return bloom == NULL || bloom->mayContain(bloomHash(key));}
+    //refills the bloom filter, sized for at least n keys, from the keys in the map
+    void rebuildBloom(int n) {
+        bloom->reset(n > bloom->capacity() ? n : bloom->capacity());
+        addBloom(T.root);
+    }
+    //adds the keys of the treap below k to the bloom filter
+    void addBloom(int k) {
+        if (k == -1) return;
+        bloom->add(bloomHash(T.p[k].key.getKey()));
+        addBloom(T.p[k].l); addBloom(T.p[k].r);
+    }
+    void deleteBloom() {
+        if (bloom == NULL) return;
+        bloom->~BloomFilter<A>();
+        T.alloc.deallocate(bloom, sizeof(BloomFilter<A>));
+        bloom = NULL;
+    }
+    void copyBloom(const TreeMap &x) {
+        bloomHash = x.bloomHash;
+        if (x.bloom == NULL) return;
+        bloom = new (T.alloc.allocate(sizeof(BloomFilter<A>))) BloomFilter<A>(*x.bloom);
+    }
+
+    //only valid for key types that compare with K directly, see the class documentation
+    template <class Q>
+    using Probe = typename std::enable_if<!std::is_same<Q, K>::value && !std::is_arithmetic<Q>::value,
+        decltype(std::declval<const Q &>() < std::declval<const K &>() && std::declval<const Q &>() > std::declval<const K &>()
+            && std::declval<const K &>() == std::declval<const Q &>())>::type;
 
     class Iterator
     {
-        treap T;
+        const treap *T;
         int cur;
-        Entry res;
     public:
         Iterator(){}
-        void init(treap _T){
+        void init(const treap *_T){
             T = _T; cur = 0; 
         }
         /*T.*
          * TODO Returns true if the iteration has more elements.
          */
         bool hasNext() {
-            if (cur >= T.size()) return 0; else return 1;
+            if (cur >= T->size()) return 0; else return 1;
         }
 
         /*alue*
@@ -211,7 +277,7 @@ public:
         const Entry &next() {
             if (!hasNext()) throw ElementNotExist("\nNo Such Element\n");
             cur ++;
-            return T.pos(cur); 
+            return T->pos(cur); 
         }
     };
 
@@ -220,47 +286,62 @@ public:
      */
     TreeMap() {
         T.clear();
+        bloom = NULL; bloomHash = NULL;
     }
 
+    /**
+     * Constructs an empty tree map drawing memory from the allocator a.
+     */
+    explicit TreeMap(const A &a): T(a) {bloom = NULL; bloomHash = NULL;}
+
     /**
      * TODO Destructor
      */
-    ~TreeMap() {} 
+    ~TreeMap() {deleteBloom();} 
 
     /**
      * TODO Assignment operator
      */
     TreeMap &operator=(const TreeMap &x) {
-        if (x == *this) return *this;
+        if (&x == this) return *this;
         T = x.T;
+        deleteBloom();
+        copyBloom(x);
         return *this;
     }
 
     /**
      * TODO Copy-constructor
      */
-    TreeMap(const TreeMap &x) {
-        T = x.T;
-    }
+    TreeMap(const TreeMap &x): T(x.T) {bloom = NULL; copyBloom(x);}
 
     /**
      * TODO Returns an iterator over the elements in this map.
      */
     Iterator iterator() const {
         Iterator itr;
-        itr.init(T);
+        itr.init(&T);
         return itr;
     }
 
     /**
      * TODO Removes all of the mappings from this map.
      */
-    void clear() {T.clear();}
+    void clear() {
+        T.clear();
+        if (bloom != NULL) bloom->clear();
+    }
 
     /**
      * TODO Returns true if this map contains a mapping for the specified key.
      */
-    bool containsKey(const K &key) const {return T.FindKey(key);}
+    bool containsKey(const K &key) const {return mayContain(key) && T.FindKey(key);}
+
+    /**
+     * Returns true if this map contains a mapping for a key equal to key, which need not be a K.
+     */
+    template <class Q, class = Probe<Q> >
+    bool containsKey(const Q &key) const {return T.FindKey(key);}
 
     /**
      * TODO Returns true if this map maps one or more keys to the specified value.
@@ -275,8 +356,20 @@ public:
      * @throw ElementNotExist
      */
     const V &get(const K &key) const {
-       if (!containsKey(key)) throw ElementNotExist("\nNo Such Element\n");
-       return T.KeyValue(key);
+       V *v = mayContain(key) ? T.KeyValue(key) : NULL;
+       if (v == NULL) throw ElementNotExist("\nNo Such Element\n");
+       return *v;
+    }
+
+    /**
+     * Returns a const reference to the value mapped to a key equal to key, which need not be a K.
+     * @throw ElementNotExist
+     */
+    template <class Q, class = Probe<Q> >
+    const V &get(const Q &key) const {
+       V *v = T.KeyValue(key);
+       if (v == NULL) throw ElementNotExist("\nNo Such Element\n");
+       return *v;
     }
 
     /**
@@ -289,7 +382,12 @@ public:
      */
     void put(const K &key, const V &value) {
         Entry cur = Entry(key, value);
+        int n = T.size();
         T.insert(cur);
+        if (bloom != NULL && T.size() > n){
+            bloom->add(bloomHash(key));
+            if (bloom->size() > bloom->capacity()) rebuildBloom(2 * T.size());
+        }
     }
 
     /**
@@ -298,10 +396,44 @@ public:
      * @throw ElementNotExist
      */
     void remove(const K &key) {
+        if (!containsKey(key)) throw ElementNotExist("\nNo Such Element\n");
+        T.remove(key);
+    }
+
+    /**
+     * Removes the mapping for a key equal to key, which need not be a K.
+     * @throw ElementNotExist
+     */
+    template <class Q, class = Probe<Q> >
+    void remove(const Q &key) {
         if (!T.FindKey(key)) throw ElementNotExist("\nNo Such Element\n");
-        T.remove(Entry(key, 0));
+        T.remove(key);
     }
 
+    /**
+     * Adds a bloom filter sized for expectedSize keys, or for the current size if that is
+     * larger, hashing the keys with H::hashCode, or H::hash64 if H has one; see the class
+     * documentation. An expectedSize of 0 or less removes the filter.
+     */
+    template <class H>
+    void setBloomFilter(int expectedSize) {
+        deleteBloom();
+        if (expectedSize <= 0) return;
+        bloomHash = &hashOf<H, K>;
+        bloom = new (T.alloc.allocate(sizeof(BloomFilter<A>))) BloomFilter<A>(expectedSize, T.alloc);
+        rebuildBloom(size());
+    }
+
+    /**
+     * Returns true if this map has a bloom filter.
+     */
+    bool hasBloomFilter() const {return bloom != NULL;}
+
+    /**
+     * Returns the allocator of this map.
+     */
+    A getAllocator() const {return T.alloc;}
+
     /**
      * TODO Returns the number of key-value mappings in this map.
      */
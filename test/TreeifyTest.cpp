@@ -0,0 +1,88 @@
+/*
+ * Treeified HashMap buckets with keys whose operator< ties keys that operator== tells
+ * apart, which the HashMap contract allows: every key has the same hash code, < compares
+ * one field and == both. Every put, lookup and removal is checked against a plain list.
+ *
+ *      g++ -std=c++11 -O1 -g -fsanitize=address,undefined -Isrc test/TreeifyTest.cpp -o treeify_test
+ *      ./treeify_test
+ */
+#include "HashMap.h"
+#include <cassert>
+#include <cstdio>
+#include <vector>
+
+struct Pair
+{
+    int a, b;
+    bool operator==(const Pair &x) const {return a == x.a && b == x.b;}
+    bool operator<(const Pair &x) const {return a < x.a;}
+};
+
+struct SameHash
+{
+    static int hashCode(const Pair &) {return 7;}
+};
+
+typedef HashMap<Pair, int, SameHash> Map;
+
+static void check(const Map &m, const std::vector<Pair> &in, const std::vector<Pair> &out) {
+    assert(m.size() == (int)in.size());
+    for (size_t i = 0; i < in.size(); i ++) assert(m.containsKey(in[i]) && m.get(in[i]) == in[i].b);
+    for (size_t i = 0; i < out.size(); i ++) assert(!m.containsKey(out[i]));
+    int n = 0;
+    for (Map::Iterator it = m.iterator(); it.hasNext(); it.next()) n ++;
+    assert(n == (int)in.size());
+}
+
+int main() {
+    //30 keys in 3 groups that < cannot tell apart
+    Map m;
+    std::vector<Pair> in, out;
+    for (int i = 0; i < 30; i ++){
+        Pair p = {i % 3, i};
+        m.put(p, i);
+        in.push_back(p);
+        check(m, in, out);
+    }
+    assert(m.stats().treeBuckets == 1);
+
+    //removal by key and through the iterator, down past the untreeify threshold
+    for (int i = 0; i < 30; i += 2){
+        Pair p = {i % 3, i};
+        assert(m.tryRemove(p));
+        out.push_back(p);
+        in.erase(in.begin() + i / 2);
+        check(m, in, out);
+    }
+    Map::MutableIterator it = m.mutableIterator();
+    while (it.hasNext()){
+        Pair p = it.next().getKey();
+        if (p.b % 3 != 0) continue;
+        it.remove();
+        out.push_back(p);
+        for (size_t i = 0; i < in.size(); i ++) if (in[i] == p) {in.erase(in.begin() + i); break;}
+    }
+    check(m, in, out);
+
+    //a pseudo-random mix of puts and removals over a few groups
+    Map r;
+    std::vector<Pair> rin, rout;
+    unsigned int x = 1;
+    for (int step = 0; step < 20000; step ++){
+        x = x * 1103515245u + 12345u;
+        Pair p = {(int)(x >> 8) % 4, (int)(x >> 16) % 64};
+        size_t i = 0;
+        while (i < rin.size() && !(rin[i] == p)) i ++;
+        if (x >> 30 & 1){
+            r.put(p, p.b);
+            if (i == rin.size()) rin.push_back(p);
+        }else{
+            assert(r.tryRemove(p) == (i < rin.size()));
+            if (i < rin.size()) rin.erase(rin.begin() + i);
+        }
+        if (step % 97 == 0) check(r, rin, rout);
+    }
+    check(r, rin, rout);
+    puts("ok");
+    return 0;
+}